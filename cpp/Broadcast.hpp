@@ -0,0 +1,337 @@
+/*
+* LibSocket C++ binding
+* Header-only publish/subscribe fan-out broadcaster
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <sys/uio.h>
+
+#include "EventLoop.hpp"
+#include "Socket.hpp"
+
+/**
+ * @brief Sends every published message to all subscribed sockets
+ * A message is encoded once into a shared immutable buffer which is queued on
+ * each subscriber, so fan-out costs no copy: on flush() each subscriber's
+ * queue is sent with a single writev(2). Subscribers that fall behind by more
+ * than the queue limit are handled according to the policy.
+ */
+class Broadcaster
+{
+public:
+    /**
+     * @brief Encoded message, shared by every queue holding it
+     */
+    using Message = std::shared_ptr<const std::string>;
+
+    /**
+     * @brief What to do when a subscriber's queue exceeds the limit
+     */
+    enum Policy {
+        DropNewest, ///< discard the message being published
+        DropOldest, ///< discard queued messages not yet started
+        Conflate,   ///< while blocked, replace a queued message with the same key; then drop oldest
+        Disconnect  ///< close the subscriber
+    };
+
+    /**
+     * @brief Maximum number of messages sent by one writev(2) call
+     */
+    static constexpr int MAX_IOV = 64;
+
+private:
+    struct Entry
+    {
+        Message msg;
+        uint64_t key;
+    };
+
+    struct Subscriber
+    {
+        Socket sock;
+        std::deque<Entry> queue;
+        std::size_t offset{ 0 };
+        std::size_t queued{ 0 };
+        bool writing{ false };
+
+        Subscriber(Socket &&s)
+            : sock{ std::move(s) }
+        {
+        }
+    };
+
+    EventLoop &_loop;
+    Policy _policy;
+    std::size_t _limit;
+    Socket _listener;
+    std::unordered_map<int, std::unique_ptr<Subscriber>> _subs;
+    std::vector<int> _dead;
+    uint64_t _dropped{ 0 };
+
+public:
+    /**
+     * @brief Construct a new broadcaster
+     * @param loop event loop driving the subscribers
+     * @param policy slow subscriber policy
+     * @param limit maximum number of bytes queued per subscriber
+     */
+    Broadcaster(EventLoop &loop, Policy policy = DropOldest, std::size_t limit = 1 << 20)
+        : _loop{ loop }, _policy{ policy }, _limit{ limit }
+    {
+    }
+    Broadcaster(const Broadcaster &) = delete;
+    Broadcaster &operator=(const Broadcaster &) = delete;
+    ~Broadcaster()
+    {
+        for (auto &sub : _subs)
+            _loop.remove(sub.first);
+        if (_listener.isOpen())
+            _loop.remove(_listener.fd());
+    }
+
+    /**
+     * @brief Accept subscribers on given endpoint
+     * @param ep endpoint to listen to
+     * @param count amount of connections to listen to
+     */
+    bool listen(const Endpoint &ep, int count = SOMAXCONN)
+    {
+        _listener.listen(ep, count);
+        _listener.setBlocking(false);
+        return (_listener.good() && _loop.add(_listener.fd(), EPOLLIN, [this](uint32_t) { this->onAccept(); }));
+    }
+    /**
+     * @brief Accept subscribers on given port and address
+     * @param port port to listen to, in network byte order
+     * @param addr address to listen to, in network byte order
+     * @param count amount of connections to listen to
+     */
+    bool listen(in_port_t port, in_addr_t addr, int count = SOMAXCONN)
+    {
+        return (this->listen(Endpoint::ipv4(ntohl(addr), ntohs(port)), count));
+    }
+    /**
+     * @brief Add a connected socket as subscriber
+     * Anything the subscriber sends is discarded.
+     * @param sock connected socket, switched to non-blocking mode
+     * @return descriptor identifying the subscriber, -1 on error
+     */
+    int subscribe(Socket &&sock)
+    {
+        sock.setBlocking(false);
+        auto sub = std::make_unique<Subscriber>(std::move(sock));
+        Subscriber *ptr = sub.get();
+        int fd = ptr->sock.fd();
+        if (!ptr->sock.good() || !_loop.add(fd, EPOLLIN, [this, ptr](uint32_t events) { this->onEvent(*ptr, events); }))
+            return (-1);
+        _subs.emplace(fd, std::move(sub));
+        return (fd);
+    }
+    /**
+     * @brief Remove a subscriber, closing its socket
+     * @param fd descriptor returned by subscribe()
+     */
+    void unsubscribe(int fd)
+    {
+        if (_subs.count(fd) != 0)
+            this->drop(fd);
+    }
+
+    /**
+     * @brief Encode a message into a shareable buffer
+     * @param data message bytes
+     */
+    static Message encode(std::string data)
+    {
+        return (std::make_shared<const std::string>(std::move(data)));
+    }
+    /**
+     * @brief Publish a message to every subscriber
+     * @param data message bytes, copied once
+     * @param key conflation key, messages with the same non-zero key supersede each other
+     */
+    void publish(std::string_view data, uint64_t key = 0)
+    {
+        this->publish(encode(std::string(data)), key);
+    }
+    /**
+     * @brief Queue an encoded message on every subscriber
+     * Nothing is sent until flush() is called, so a burst of messages reaches
+     * each subscriber with one writev(2). Empty messages are ignored.
+     * @param msg encoded message
+     * @param key conflation key, messages with the same non-zero key supersede each other
+     */
+    void publish(const Message &msg, uint64_t key = 0)
+    {
+        // queued, it would keep the subscriber waiting for writability forever
+        if (msg->empty())
+            return;
+        for (auto &it : _subs)
+            if (!this->enqueue(*it.second, msg, key))
+                _dead.push_back(it.first);
+        this->reap();
+    }
+    /**
+     * @brief Send queued messages to idle subscribers
+     * Subscribers whose socket is full are written to once it becomes writable.
+     */
+    void flush()
+    {
+        for (auto &it : _subs) {
+            Subscriber &sub = *it.second;
+            if (!sub.writing && !sub.queue.empty() && !this->flush(sub))
+                _dead.push_back(it.first);
+        }
+        this->reap();
+    }
+
+    /**
+     * @brief Number of subscribers
+     */
+    inline std::size_t subscribers() const
+    {
+        return (_subs.size());
+    }
+    /**
+     * @brief Number of messages dropped or conflated away so far
+     */
+    inline uint64_t dropped() const
+    {
+        return (_dropped);
+    }
+    /**
+     * @brief Number of bytes queued for a subscriber
+     * @param fd descriptor returned by subscribe()
+     */
+    std::size_t queued(int fd) const
+    {
+        auto it = _subs.find(fd);
+        return (it == _subs.end() ? 0 : it->second->queued - it->second->offset);
+    }
+
+private:
+    void onAccept()
+    {
+        while (true) {
+            Socket client = _listener.accept();
+            if (!client.isOpen())
+                return;
+            this->subscribe(std::move(client));
+        }
+    }
+
+    void onEvent(Subscriber &sub, uint32_t events)
+    {
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+            while (sub.sock.fill() > 0)
+                sub.sock.consume(sub.sock.bufferedSize());
+            if (!sub.sock.good()) {
+                this->drop(sub.sock.fd());
+                return;
+            }
+        }
+        if ((events & EPOLLOUT) && !this->flush(sub))
+            this->drop(sub.sock.fd());
+    }
+
+    /**
+     * @brief Queue a message, applying the policy if the subscriber is behind
+     * @return false if the subscriber must be disconnected
+     */
+    bool enqueue(Subscriber &sub, const Message &msg, uint64_t key)
+    {
+        std::size_t size = msg->size();
+        // the front entry cannot be replaced or dropped once partially sent
+        std::size_t first = sub.offset > 0 ? 1 : 0;
+
+        if (_policy == Conflate && key != 0 && sub.writing) {
+            for (std::size_t i = first; i < sub.queue.size(); ++i) {
+                Entry &entry = sub.queue[i];
+                if (entry.key == key) {
+                    sub.queued = sub.queued - entry.msg->size() + size;
+                    entry.msg = msg;
+                    ++_dropped;
+                    return (true);
+                }
+            }
+        }
+        if (sub.queued - sub.offset + size > _limit) {
+            if (_policy == Disconnect)
+                return (false);
+            if (_policy == DropNewest) {
+                ++_dropped;
+                return (true);
+            }
+            while (sub.queue.size() > first && sub.queued - sub.offset + size > _limit) {
+                sub.queued -= sub.queue[first].msg->size();
+                sub.queue.erase(sub.queue.begin() + first);
+                ++_dropped;
+            }
+        }
+        sub.queue.push_back(Entry{ msg, key });
+        sub.queued += size;
+        return (true);
+    }
+
+    /**
+     * @brief Send queued messages, watching for writability if it would block
+     * @return false if the connection failed
+     */
+    bool flush(Subscriber &sub)
+    {
+        struct iovec iov[MAX_IOV];
+
+        while (!sub.queue.empty()) {
+            int count = static_cast<int>(std::min<std::size_t>(sub.queue.size(), MAX_IOV));
+            for (int i = 0; i < count; ++i) {
+                const std::string &data = *sub.queue[i].msg;
+                iov[i].iov_base = const_cast<char *>(data.data());
+                iov[i].iov_len = data.size();
+            }
+            iov[0].iov_base = static_cast<char *>(iov[0].iov_base) + sub.offset;
+            iov[0].iov_len -= sub.offset;
+            sub.sock.writev(iov, count);
+            if (sub.sock.writeFailed())
+                return (false);
+            std::size_t written = sub.sock.gcount();
+            if (written == 0)
+                break;
+            written += sub.offset;
+            while (!sub.queue.empty() && written >= sub.queue.front().msg->size()) {
+                std::size_t size = sub.queue.front().msg->size();
+                written -= size;
+                sub.queued -= size;
+                sub.queue.pop_front();
+            }
+            sub.offset = written;
+        }
+        bool pending = !sub.queue.empty();
+        if (pending != sub.writing) {
+            sub.writing = pending;
+            _loop.modify(sub.sock.fd(), pending ? (EPOLLIN | EPOLLOUT) : EPOLLIN);
+        }
+        return (true);
+    }
+
+    void reap()
+    {
+        for (int fd : _dead)
+            this->drop(fd);
+        _dead.clear();
+    }
+
+    void drop(int fd)
+    {
+        _loop.remove(fd);
+        _subs.erase(fd);
+    }
+};
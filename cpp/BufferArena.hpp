@@ -0,0 +1,333 @@
+/*
+* LibSocket C++ binding
+* Header-only huge-page backed arena for socket buffers
+*
+* Define LIBSOCKET_BUFFER_ARENA to allocate Socket buffers from it.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
+
+/**
+ * @brief Per-thread arena of socket buffers carved from 2 MB huge pages
+ * Buffers of 4 KB to 256 KB are rounded up to a power of two and taken from
+ * slabs: 2 MB regions each holding buffers of one size, mapped with
+ * MAP_HUGETLB when huge pages are reserved and otherwise aligned to 2 MB and
+ * madvise(MADV_HUGEPAGE)d for transparent huge pages. Thousands of
+ * connection buffers then share a few TLB entries instead of one per 4 KB
+ * page. Other sizes go to operator new.
+ *
+ * Each thread allocates from its own sub-arena without locking. A buffer
+ * freed by another thread, e.g. after a connection migrated, is handed back
+ * to its owner through a lock-free list. Sub-arenas of exited threads are
+ * reused by new threads. Empty slabs are kept for reuse until trim()
+ * releases the ones idle for long enough.
+ */
+class BufferArena
+{
+public:
+    static constexpr std::size_t SLAB_SIZE = 2 << 20;
+    static constexpr std::size_t MIN_BLOCK = 4 << 10;
+    static constexpr std::size_t MAX_BLOCK = 256 << 10;
+    static constexpr unsigned CLASSES = 7;
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief How slabs are backed
+     */
+    enum Backing : uint8_t { HugeTlb, Transparent, SmallPages };
+
+    struct Stats
+    {
+        /**
+         * @brief Slabs by backing
+         */
+        std::size_t slabs[3];
+        /**
+         * @brief Buffers handed out and not freed yet
+         */
+        std::size_t inUse;
+        /**
+         * @brief Slabs released by trim() so far
+         */
+        std::size_t released;
+    };
+
+private:
+    /**
+     * @brief Slab header, stored in the slab's first block
+     */
+    struct Slab
+    {
+        BufferArena *owner;
+        char *free;
+        char *bump;
+        char *end;
+        unsigned cls;
+        unsigned used;
+        Backing backing;
+        Clock::time_point emptySince;
+    };
+
+    std::vector<Slab *> _slabs[CLASSES];
+    Slab *_current[CLASSES]{};
+    std::atomic<char *> _remote{ nullptr };
+    std::size_t _inUse{ 0 };
+    std::size_t _released{ 0 };
+
+    BufferArena() = default;
+
+public:
+    BufferArena(const BufferArena &) = delete;
+    BufferArena &operator=(const BufferArena &) = delete;
+
+    /**
+     * @brief Get the calling thread's sub-arena
+     */
+    static BufferArena &local()
+    {
+        thread_local Handle handle;
+        return (*handle.arena);
+    }
+
+    /**
+     * @brief Allocate 'n' bytes
+     */
+    static void *allocate(std::size_t n)
+    {
+        if (n < MIN_BLOCK || n > MAX_BLOCK)
+            return (::operator new(n));
+        return (local().take(classOf(n)));
+    }
+    /**
+     * @brief Free 'n' bytes allocated by allocate(), from any thread
+     */
+    static void deallocate(void *p, std::size_t n)
+    {
+        if (n < MIN_BLOCK || n > MAX_BLOCK) {
+            ::operator delete(p);
+            return;
+        }
+        char *block = static_cast<char *>(p);
+        Slab *slab = slabOf(block);
+        BufferArena &self = local();
+        if (slab->owner == &self) {
+            self.give(slab, block);
+            return;
+        }
+        // another thread's buffer: queue it for its owner
+        char *head = slab->owner->_remote.load(std::memory_order_relaxed);
+        do
+            *reinterpret_cast<char **>(block) = head;
+        while (!slab->owner->_remote.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Release slabs empty for at least 'idle'
+     * Call when the owning thread goes idle, e.g. when its event loop had
+     * nothing to do, so that a burst of connections does not pin its memory
+     * forever.
+     * @return number of slabs released
+     */
+    std::size_t trim(Clock::duration idle = std::chrono::seconds(0))
+    {
+        Clock::time_point now = Clock::now();
+        std::size_t count = 0;
+
+        this->drainRemote();
+        for (unsigned cls = 0; cls < CLASSES; ++cls) {
+            std::vector<Slab *> &slabs = _slabs[cls];
+            for (std::size_t i = 0; i < slabs.size();) {
+                Slab *slab = slabs[i];
+                if (slab->used != 0 || now - slab->emptySince < idle) {
+                    ++i;
+                    continue;
+                }
+                if (_current[cls] == slab)
+                    _current[cls] = nullptr;
+                slabs[i] = slabs.back();
+                slabs.pop_back();
+                munmap(slab, SLAB_SIZE);
+                ++count;
+            }
+        }
+        _released += count;
+        return (count);
+    }
+    /**
+     * @brief Get the counters of this sub-arena
+     */
+    Stats stats() const
+    {
+        Stats stats = { { 0, 0, 0 }, _inUse, _released };
+        for (const std::vector<Slab *> &slabs : _slabs)
+            for (const Slab *slab : slabs)
+                ++stats.slabs[slab->backing];
+        return (stats);
+    }
+
+private:
+    /**
+     * @brief Owns the thread's sub-arena and hands it over to a later thread on exit
+     */
+    struct Handle
+    {
+        BufferArena *arena;
+
+        Handle()
+        {
+            std::lock_guard<std::mutex> lock(orphansLock());
+            if (orphans().empty()) {
+                arena = new BufferArena();
+            } else {
+                arena = orphans().back();
+                orphans().pop_back();
+            }
+        }
+        ~Handle()
+        {
+            std::lock_guard<std::mutex> lock(orphansLock());
+            orphans().push_back(arena);
+        }
+    };
+
+    static std::vector<BufferArena *> &orphans()
+    {
+        static std::vector<BufferArena *> list;
+        return (list);
+    }
+    static std::mutex &orphansLock()
+    {
+        static std::mutex lock;
+        return (lock);
+    }
+
+    static unsigned classOf(std::size_t n)
+    {
+        unsigned cls = 0;
+        while ((MIN_BLOCK << cls) < n)
+            ++cls;
+        return (cls);
+    }
+    static Slab *slabOf(char *block)
+    {
+        return (reinterpret_cast<Slab *>(reinterpret_cast<uintptr_t>(block) & ~(SLAB_SIZE - 1)));
+    }
+
+    char *take(unsigned cls)
+    {
+        Slab *slab = _current[cls];
+        if (slab == nullptr || (slab->free == nullptr && slab->bump == slab->end)) {
+            this->drainRemote();
+            slab = nullptr;
+            for (Slab *s : _slabs[cls])
+                if (s->free != nullptr || s->bump != s->end) {
+                    slab = s;
+                    break;
+                }
+            if (slab == nullptr && (slab = this->map(cls)) == nullptr)
+                throw std::bad_alloc();
+            _current[cls] = slab;
+        }
+        char *block = slab->free;
+        if (block != nullptr) {
+            slab->free = *reinterpret_cast<char **>(block);
+        } else {
+            block = slab->bump;
+            slab->bump += MIN_BLOCK << cls;
+        }
+        ++slab->used;
+        ++_inUse;
+        return (block);
+    }
+
+    void give(Slab *slab, char *block)
+    {
+        *reinterpret_cast<char **>(block) = slab->free;
+        slab->free = block;
+        --_inUse;
+        if (--slab->used == 0)
+            slab->emptySince = Clock::now();
+    }
+
+    void drainRemote()
+    {
+        char *block = _remote.exchange(nullptr, std::memory_order_acquire);
+        while (block != nullptr) {
+            char *next = *reinterpret_cast<char **>(block);
+            this->give(slabOf(block), block);
+            block = next;
+        }
+    }
+
+    /**
+     * @brief Map a new slab, the header taking its first block
+     */
+    Slab *map(unsigned cls)
+    {
+        Backing backing = HugeTlb;
+        void *addr = mmap(nullptr, SLAB_SIZE, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT), -1, 0);
+        if (addr == MAP_FAILED) {
+            // no reserved huge pages: align a regular mapping for transparent ones
+            char *raw = static_cast<char *>(mmap(nullptr, 2 * SLAB_SIZE, PROT_READ | PROT_WRITE,
+                                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (raw == MAP_FAILED)
+                return (nullptr);
+            char *aligned = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(raw) + SLAB_SIZE - 1) & ~(SLAB_SIZE - 1));
+            if (aligned != raw)
+                munmap(raw, aligned - raw);
+            munmap(aligned + SLAB_SIZE, raw + SLAB_SIZE - aligned);
+            addr = aligned;
+            backing = madvise(addr, SLAB_SIZE, MADV_HUGEPAGE) == 0 ? Transparent : SmallPages;
+        }
+        char *base = static_cast<char *>(addr);
+        std::size_t block = MIN_BLOCK << cls;
+        Slab *slab = new (base) Slab{ this, nullptr, base + block, base + SLAB_SIZE, cls, 0, backing, Clock::now() };
+        _slabs[cls].push_back(slab);
+        return (slab);
+    }
+};
+
+/**
+ * @brief Standard allocator over BufferArena
+ */
+template <typename T>
+struct ArenaAllocator
+{
+    using value_type = T;
+
+    ArenaAllocator() = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &)
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        return (static_cast<T *>(BufferArena::allocate(n * sizeof(T))));
+    }
+    void deallocate(T *p, std::size_t n)
+    {
+        BufferArena::deallocate(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &) const
+    {
+        return (true);
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &) const
+    {
+        return (false);
+    }
+};
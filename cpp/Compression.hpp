@@ -0,0 +1,381 @@
+/*
+* LibSocket C++ binding
+* Header-only streaming compression layer (LZ4, zstd)
+*
+* Codecs are enabled when their headers are found: link with -llz4 and/or
+* -lzstd accordingly.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <sys/uio.h>
+
+#if __has_include(<lz4.h>)
+#include <lz4.h>
+#define LIBSOCKET_HAS_LZ4 1
+#endif
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define LIBSOCKET_HAS_ZSTD 1
+#endif
+
+#include "Endian.hpp"
+#include "Socket.hpp"
+
+/**
+ * @brief Compression codec, also its bit in negotiation masks
+ */
+enum class Codec : uint8_t {
+    None = 0,
+    Lz4 = 1,
+    Zstd = 2
+};
+
+/**
+ * @brief Block-compressing stream over a connected Socket
+ * Written data is gathered into blocks of up to BLOCK_SIZE bytes, each sent
+ * as [codec:u8][raw size:u32][compressed size:u32][payload]. Blocks that do
+ * not shrink are sent uncompressed. Both peers call negotiate() first to agree
+ * on a codec.
+ */
+class CompressedSocket
+{
+public:
+    /**
+     * @brief Size of a block header
+     */
+    static constexpr std::size_t HEADER_SIZE = 9;
+    /**
+     * @brief Maximum amount of uncompressed data per block
+     */
+    static constexpr std::size_t BLOCK_SIZE = 64 << 10;
+
+private:
+    Socket &_sock;
+    Codec _codec{ Codec::None };
+    int _level;
+    std::size_t _flushSize{ BLOCK_SIZE };
+    std::string _block;
+    std::string _packed;
+    std::string _plain;
+    std::size_t _plainpos{ 0 };
+    std::streamsize _count{ 0 };
+#if defined(LIBSOCKET_HAS_ZSTD)
+    ZSTD_CCtx *_cctx{ nullptr };
+    ZSTD_DCtx *_dctx{ nullptr };
+#endif
+
+public:
+    /**
+     * @brief Construct a compressed stream over a connected socket
+     * @param sock connected socket
+     * @param level zstd compression level
+     */
+    CompressedSocket(Socket &sock, int level = 3)
+        : _sock{ sock }, _level{ level }
+    {
+    }
+    CompressedSocket(const CompressedSocket &) = delete;
+    CompressedSocket &operator=(const CompressedSocket &) = delete;
+    ~CompressedSocket()
+    {
+        this->flush();
+#if defined(LIBSOCKET_HAS_ZSTD)
+        ZSTD_freeCCtx(_cctx);
+        ZSTD_freeDCtx(_dctx);
+#endif
+    }
+
+    /**
+     * @brief Get the mask of codecs compiled in
+     */
+    static uint8_t supported()
+    {
+        uint8_t mask = 0;
+#if defined(LIBSOCKET_HAS_LZ4)
+        mask |= 1 << static_cast<int>(Codec::Lz4);
+#endif
+#if defined(LIBSOCKET_HAS_ZSTD)
+        mask |= 1 << static_cast<int>(Codec::Zstd);
+#endif
+        return (mask);
+    }
+
+    /**
+     * @brief Agree on a codec with the peer
+     * Both peers exchange their supported codecs and preference: zstd is chosen
+     * if either side favors ratio, LZ4 otherwise, among codecs both support.
+     * @param preferRatio favor compression ratio over latency
+     * @return chosen codec
+     */
+    Codec negotiate(bool preferRatio = false)
+    {
+        uint8_t peerMask = 0;
+        uint8_t peerRatio = 0;
+
+        _sock.put<uint8_t>(supported()).put<uint8_t>(preferRatio).flush();
+        _sock.get(peerMask).get(peerRatio);
+        uint8_t common = supported() & peerMask;
+        bool ratio = preferRatio || peerRatio;
+        bool lz4 = common & (1 << static_cast<int>(Codec::Lz4));
+        bool zstd = common & (1 << static_cast<int>(Codec::Zstd));
+        if (!_sock.good())
+            _codec = Codec::None;
+        else if (zstd && (ratio || !lz4))
+            _codec = Codec::Zstd;
+        else if (lz4)
+            _codec = Codec::Lz4;
+        else
+            _codec = Codec::None;
+        return (_codec);
+    }
+
+    /**
+     * @brief Get the codec in use for outgoing blocks
+     */
+    inline Codec codec() const
+    {
+        return (_codec);
+    }
+    /**
+     * @brief Set the amount of buffered data that triggers sending a block
+     * Smaller values lower latency, larger ones improve the ratio.
+     * @param size threshold, at most BLOCK_SIZE
+     */
+    void setFlushSize(std::size_t size)
+    {
+        _flushSize = std::max<std::size_t>(1, std::min(size, BLOCK_SIZE));
+    }
+
+    /**
+     * @brief Write data, compressing it once a block is full
+     * gcount() tells how many bytes were sent or buffered before the socket
+     * failed, if it did. On a non-blocking socket, a block that would block
+     * waits in the Socket's send buffer, and no more data is taken until it
+     * is sent: gcount() is then short with the socket still good.
+     * @param buffer buffer to write data from
+     * @param len number of bytes to write
+     */
+    CompressedSocket &write(const char *buffer, std::streamsize len)
+    {
+        _count = 0;
+        while (len > 0 && _sock.good()) {
+            if (_sock.unflushed() > 0 && _sock.flush().unflushed() > 0)
+                break;
+            std::size_t n = std::min<std::size_t>(len, _flushSize - _block.size());
+            _block.append(buffer, n);
+            buffer += n;
+            len -= n;
+            if (_block.size() >= _flushSize)
+                this->sendBlock();
+            if (_sock.good())
+                _count += n;
+        }
+        return (*this);
+    }
+    /**
+     * @brief Compress and send buffered data
+     * On a non-blocking socket, what would block stays in the Socket's send
+     * buffer: call again once writable, until Socket::unflushed() is 0.
+     */
+    CompressedSocket &flush()
+    {
+        if (!_block.empty())
+            this->sendBlock();
+        else
+            _sock.flush();
+        return (*this);
+    }
+
+    /**
+     * @brief Read decompressed data
+     * Receives and decompresses a block when none is pending, straight into
+     * 'buffer' if the whole block fits. On a non-blocking socket that would
+     * block before a block is complete, gcount() is 0 with the socket still
+     * good; the part received is kept for the next call.
+     * @param buffer buffer to read data into
+     * @param len maximum number of bytes to read
+     */
+    CompressedSocket &read(char *buffer, std::streamsize len)
+    {
+        _count = 0;
+        if (_plainpos == _plain.size()) {
+            std::size_t direct = 0;
+            if (!this->receiveBlock(buffer, len, direct) || direct > 0) {
+                _count = direct;
+                return (*this);
+            }
+        }
+        _count = std::min<std::streamsize>(len, _plain.size() - _plainpos);
+        std::memcpy(buffer, _plain.data() + _plainpos, _count);
+        _plainpos += _count;
+        return (*this);
+    }
+
+    /**
+     * @brief Get number of bytes transferred by the last read or write
+     */
+    inline std::streamsize gcount() const
+    {
+        return (_count);
+    }
+    /**
+     * @brief Check whether the underlying socket is usable
+     */
+    inline bool good() const
+    {
+        return (_sock.good());
+    }
+    explicit operator bool() const
+    {
+        return (!_sock.fail());
+    }
+
+private:
+    void sendBlock()
+    {
+        char header[HEADER_SIZE];
+        Codec codec = _codec;
+        std::size_t packed = this->compress(codec);
+
+        if (packed == 0 || packed >= _block.size()) {
+            codec = Codec::None;
+            packed = _block.size();
+        }
+        header[0] = static_cast<char>(codec);
+        ByteOrder::store<Endian::Big>(header + 1, static_cast<uint32_t>(_block.size()));
+        ByteOrder::store<Endian::Big>(header + 5, static_cast<uint32_t>(packed));
+        struct iovec iov[2] = {
+            { header, HEADER_SIZE },
+            { const_cast<char *>(codec == Codec::None ? _block.data() : _packed.data()), packed }
+        };
+        int first = 0;
+        // an earlier block still queued goes first, this one is queued behind it
+        if (_sock.flush().unflushed() == 0 && _sock.writev(iov, 2)) {
+            std::size_t written = _sock.gcount();
+            while (first < 2 && written >= iov[first].iov_len)
+                written -= iov[first++].iov_len;
+            if (first < 2) {
+                iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + written;
+                iov[first].iov_len -= written;
+            }
+        }
+        // what the socket did not take waits in its send buffer
+        for (; first < 2 && _sock.good(); ++first)
+            _sock << std::string_view(static_cast<const char *>(iov[first].iov_base), iov[first].iov_len);
+        _sock.flush();
+        _block.clear();
+    }
+
+    /**
+     * @brief Compress the pending block into _packed
+     * @return compressed size, 0 if the codec is unavailable or failed
+     */
+    std::size_t compress(Codec codec)
+    {
+#if defined(LIBSOCKET_HAS_LZ4)
+        if (codec == Codec::Lz4) {
+            _packed.resize(LZ4_compressBound(_block.size()));
+            int size = LZ4_compress_default(_block.data(), &_packed[0], _block.size(), _packed.size());
+            return (size > 0 ? size : 0);
+        }
+#endif
+#if defined(LIBSOCKET_HAS_ZSTD)
+        if (codec == Codec::Zstd) {
+            if (_cctx == nullptr)
+                _cctx = ZSTD_createCCtx();
+            _packed.resize(ZSTD_compressBound(_block.size()));
+            std::size_t size = ZSTD_compressCCtx(_cctx, &_packed[0], _packed.size(), _block.data(), _block.size(), _level);
+            return (ZSTD_isError(size) ? 0 : size);
+        }
+#endif
+        (void)codec;
+        return (0);
+    }
+
+    /**
+     * @brief Receive and decompress the next block
+     * The block is gathered in the Socket's receive buffer and decompressed
+     * from there, so a block arriving in parts completes over several calls.
+     * @param buffer caller's buffer, the block goes there if it fits
+     * @param len size of the caller's buffer
+     * @param direct set to the block size if it went to the caller's buffer,
+     * 0 if it went to _plain
+     * @return false if no block is complete yet or the socket failed
+     */
+    bool receiveBlock(char *buffer, std::size_t len, std::size_t &direct)
+    {
+        uint8_t codec = 0;
+        uint32_t rawSize = 0;
+        uint32_t packedSize = 0;
+
+        while (true) {
+            if (_sock.bufferedSize() >= HEADER_SIZE) {
+                const char *header = _sock.bufferedData();
+                codec = static_cast<uint8_t>(header[0]);
+                rawSize = ByteOrder::load<Endian::Big, uint32_t>(header + 1);
+                packedSize = ByteOrder::load<Endian::Big, uint32_t>(header + 5);
+                if (rawSize > BLOCK_SIZE || packedSize > rawSize || (codec == 0 && rawSize != packedSize)) {
+                    _sock.setstate(std::ios::badbit);
+                    return (false);
+                }
+                if (_sock.bufferedSize() >= HEADER_SIZE + packedSize)
+                    break;
+            }
+            if (!_sock.good() || _sock.fill() <= 0)
+                return (false);
+        }
+        const char *packed = _sock.bufferedData() + HEADER_SIZE;
+        char *dst = buffer;
+        if (rawSize > len) {
+            _plain.resize(rawSize);
+            dst = &_plain[0];
+        }
+        bool ok = true;
+        if (codec == 0)
+            std::memcpy(dst, packed, rawSize);
+        else
+            ok = this->decompress(static_cast<Codec>(codec), packed, packedSize, dst, rawSize);
+        _sock.consume(HEADER_SIZE + packedSize);
+        if (!ok) {
+            _plain.clear();
+            _sock.setstate(std::ios::badbit);
+            return (false);
+        }
+        direct = (dst == buffer) ? rawSize : 0;
+        _plainpos = 0;
+        if (dst == buffer)
+            _plain.clear();
+        return (true);
+    }
+
+    /**
+     * @brief Decompress a block payload into 'dst', which holds 'rawSize' bytes
+     */
+    bool decompress(Codec codec, const char *src, std::size_t srcSize, char *dst, std::size_t rawSize)
+    {
+#if defined(LIBSOCKET_HAS_LZ4)
+        if (codec == Codec::Lz4)
+            return (LZ4_decompress_safe(src, dst, srcSize, rawSize) == static_cast<int>(rawSize));
+#endif
+#if defined(LIBSOCKET_HAS_ZSTD)
+        if (codec == Codec::Zstd) {
+            if (_dctx == nullptr)
+                _dctx = ZSTD_createDCtx();
+            std::size_t size = ZSTD_decompressDCtx(_dctx, dst, rawSize, src, srcSize);
+            return (size == rawSize);
+        }
+#endif
+        (void)codec;
+        (void)src;
+        (void)srcSize;
+        (void)dst;
+        (void)rawSize;
+        return (false);
+    }
+};
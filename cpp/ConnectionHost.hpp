@@ -0,0 +1,158 @@
+/*
+* LibSocket C++ binding
+* Header-only connection hosting shared by the servers
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "EventLoop.hpp"
+#include "Socket.hpp"
+
+/**
+ * @brief Connections of a server watched on an EventLoop
+ * Reads into each connection's socket, hands it to the server's 'process'
+ * callback, and writes back what was appended to its output. 'Connection'
+ * has 'sock', 'out', 'outpos', 'closing', 'writing' and 'requests' members.
+ */
+template <typename Connection>
+class ConnectionHost
+{
+public:
+    /**
+     * @brief Parse buffered input and append responses to the output
+     */
+    using Process = std::function<void(Connection &)>;
+
+private:
+    EventLoop &_loop;
+    Process _process;
+    // shared so that a migration task dropped unrun still closes the connection
+    std::unordered_map<int, std::shared_ptr<Connection>> _conns;
+
+public:
+    /**
+     * @brief Construct a new set of connections
+     * @param loop event loop watching them
+     * @param process called after new input was buffered
+     */
+    ConnectionHost(EventLoop &loop, Process process)
+        : _loop{ loop }, _process{ std::move(process) }
+    {
+    }
+    ConnectionHost(const ConnectionHost &) = delete;
+    ConnectionHost &operator=(const ConnectionHost &) = delete;
+    ~ConnectionHost()
+    {
+        for (auto &conn : _conns)
+            _loop.remove(conn.first);
+    }
+
+    /**
+     * @brief Get the descriptors of the open connections
+     * Like every member below, call from the loop's thread.
+     */
+    std::vector<int> connections() const
+    {
+        std::vector<int> fds;
+        fds.reserve(_conns.size());
+        for (const auto &conn : _conns)
+            fds.push_back(conn.first);
+        return (fds);
+    }
+    /**
+     * @brief Get the number of requests a connection made so far, 0 if unknown
+     */
+    uint64_t requests(int fd) const
+    {
+        auto it = _conns.find(fd);
+        return (it == _conns.end() ? 0 : it->second->requests);
+    }
+
+    /**
+     * @brief Watch a connection
+     * @param moved true if it comes from another loop: its state is then
+     * reallocated from this thread, on this thread's NUMA node
+     */
+    void adopt(std::shared_ptr<Connection> conn, bool moved = false)
+    {
+        if (moved) {
+            conn = std::make_shared<Connection>(std::move(*conn));
+            conn->sock.relocate();
+            Socket::relocate(conn->out);
+        }
+        Connection *ptr = conn.get();
+        int fd = ptr->sock.fd();
+        uint32_t watch = ptr->writing ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        if (_loop.add(fd, watch, [this, ptr](uint32_t events) { this->onEvent(*ptr, events); }))
+            _conns.emplace(fd, std::move(conn));
+    }
+    /**
+     * @brief Move a live connection to another set, running on another loop
+     * Call outside the callbacks, from a posted task for instance; 'target'
+     * adopts it on its own loop's thread.
+     * @return false if 'fd' is not one of these connections
+     */
+    bool migrate(int fd, ConnectionHost &target)
+    {
+        auto it = _conns.find(fd);
+        if (it == _conns.end())
+            return (false);
+        std::shared_ptr<Connection> conn = std::move(it->second);
+        _conns.erase(it);
+        _loop.migrate(fd, target._loop, [&target, conn]() { target.adopt(conn, true); });
+        return (true);
+    }
+
+private:
+    void onEvent(Connection &conn, uint32_t events)
+    {
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+            while (!conn.closing && conn.sock.fill() > 0)
+                _process(conn);
+            if (!conn.sock.good())
+                conn.closing = true;
+        }
+        if (!this->flush(conn) || (conn.closing && conn.outpos == conn.out.size()))
+            this->drop(conn.sock.fd());
+    }
+
+    /**
+     * @brief Write pending output, watching for writability if it would block
+     * @return false if the connection failed
+     */
+    bool flush(Connection &conn)
+    {
+        while (conn.outpos < conn.out.size()) {
+            conn.sock.write(conn.out.data() + conn.outpos, conn.out.size() - conn.outpos);
+            if (conn.sock.writeFailed())
+                return (false);
+            if (conn.sock.gcount() == 0)
+                break;
+            conn.outpos += conn.sock.gcount();
+        }
+        bool pending = conn.outpos < conn.out.size();
+        if (!pending) {
+            conn.out.clear();
+            conn.outpos = 0;
+        }
+        // once closing, stop watching input: an end of stream would keep reporting it
+        if (pending != conn.writing || (pending && conn.closing)) {
+            conn.writing = pending;
+            _loop.modify(conn.sock.fd(), conn.closing ? EPOLLOUT : pending ? (EPOLLIN | EPOLLOUT) : EPOLLIN);
+        }
+        return (true);
+    }
+
+    void drop(int fd)
+    {
+        _loop.remove(fd);
+        _conns.erase(fd);
+    }
+};
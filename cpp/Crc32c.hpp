@@ -0,0 +1,217 @@
+/*
+* LibSocket C++ binding
+* Header-only CRC32C (Castagnoli) checksum
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+/**
+ * @brief CRC32C checksum, as used by iSCSI, SCTP and ext4
+ * Uses the SSE4.2 crc32 instruction over three interleaved streams when the
+ * CPU supports it, slicing-by-8 tables otherwise.
+ */
+class Crc32c
+{
+private:
+    uint32_t _crc{ 0 };
+
+    /**
+     * @brief Stream lengths of the interleaved hardware loop
+     */
+    static constexpr std::size_t LONG = 8192;
+    static constexpr std::size_t SHORT = 256;
+
+    struct Tables
+    {
+        uint32_t slice[8][256];
+        uint32_t shiftLong[4][256];
+        uint32_t shiftShort[4][256];
+        bool hardware;
+    };
+
+public:
+    /**
+     * @brief Extend a checksum with more data
+     * @param crc checksum of the preceding data, 0 to start
+     * @param data data to add
+     * @param len number of bytes
+     * @return checksum of the preceding data followed by 'data'
+     */
+    static uint32_t extend(uint32_t crc, const void *data, std::size_t len)
+    {
+        const Tables &t = tables();
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+#if defined(__x86_64__)
+        if (t.hardware)
+            return (~extendHardware(t, ~crc, p, len));
+#endif
+        return (~extendSoftware(t, ~crc, p, len));
+    }
+    /**
+     * @brief Compute the checksum of a buffer
+     * @param data data to checksum
+     * @param len number of bytes
+     */
+    static uint32_t compute(const void *data, std::size_t len)
+    {
+        return (extend(0, data, len));
+    }
+
+    /**
+     * @brief Add data to the running checksum
+     * @param data data to add
+     * @param len number of bytes
+     */
+    Crc32c &update(const void *data, std::size_t len)
+    {
+        _crc = extend(_crc, data, len);
+        return (*this);
+    }
+    /**
+     * @brief Get the checksum of the data added so far
+     */
+    inline uint32_t value() const
+    {
+        return (_crc);
+    }
+    /**
+     * @brief Restart from an empty input
+     */
+    inline void reset()
+    {
+        _crc = 0;
+    }
+
+    /**
+     * @brief Check whether the hardware implementation is in use
+     */
+    static bool hardware()
+    {
+        return (tables().hardware);
+    }
+
+private:
+    /**
+     * @brief Extend a raw (non-inverted) CRC register with table lookups
+     */
+    static uint32_t extendSoftware(const Tables &t, uint32_t crc, const unsigned char *p, std::size_t len)
+    {
+        for (; len >= 8; len -= 8, p += 8) {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            word ^= crc;
+            crc = t.slice[7][word & 0xFF] ^ t.slice[6][(word >> 8) & 0xFF]
+                ^ t.slice[5][(word >> 16) & 0xFF] ^ t.slice[4][(word >> 24) & 0xFF]
+                ^ t.slice[3][(word >> 32) & 0xFF] ^ t.slice[2][(word >> 40) & 0xFF]
+                ^ t.slice[1][(word >> 48) & 0xFF] ^ t.slice[0][word >> 56];
+        }
+        for (; len > 0; --len, ++p)
+            crc = (crc >> 8) ^ t.slice[0][(crc ^ *p) & 0xFF];
+        return (crc);
+    }
+
+    static const Tables &tables()
+    {
+        static const Tables t = makeTables();
+        return (t);
+    }
+
+    static Tables makeTables()
+    {
+        Tables t;
+
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t crc = n;
+            for (int k = 0; k < 8; ++k)
+                crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+            t.slice[0][n] = crc;
+        }
+        for (uint32_t n = 0; n < 256; ++n)
+            for (int k = 1; k < 8; ++k)
+                t.slice[k][n] = (t.slice[k - 1][n] >> 8) ^ t.slice[0][t.slice[k - 1][n] & 0xFF];
+        t.hardware = false;
+#if defined(__x86_64__)
+        t.hardware = __builtin_cpu_supports("sse4.2");
+#endif
+        makeShift(t, t.shiftLong, LONG);
+        makeShift(t, t.shiftShort, SHORT);
+        return (t);
+    }
+
+    /**
+     * @brief Build tables advancing a CRC register over 'len' zero bytes
+     * The register update is linear, so shifting a value is the XOR of the
+     * shifts of its four bytes.
+     */
+    static void makeShift(const Tables &t, uint32_t shift[4][256], std::size_t len)
+    {
+        static const unsigned char zeros[LONG] = { 0 };
+
+        for (int k = 0; k < 4; ++k)
+            for (uint32_t n = 0; n < 256; ++n)
+                shift[k][n] = extendSoftware(t, n << (8 * k), zeros, len);
+    }
+
+    static inline uint32_t shift(const uint32_t table[4][256], uint32_t crc)
+    {
+        return (table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF]
+                ^ table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24]);
+    }
+
+#if defined(__x86_64__)
+    /**
+     * @brief Extend a raw CRC register with the crc32 instruction
+     * Three independent streams hide the instruction's latency; their results
+     * are merged by shifting over the following streams' lengths.
+     */
+    __attribute__((target("sse4.2")))
+    static uint32_t extendHardware(const Tables &t, uint32_t crc, const unsigned char *p, std::size_t len)
+    {
+        uint64_t crc0 = crc;
+
+        while (len >= 3 * LONG) {
+            crc0 = stripes(crc0, p, LONG, t.shiftLong);
+            p += 3 * LONG;
+            len -= 3 * LONG;
+        }
+        while (len >= 3 * SHORT) {
+            crc0 = stripes(crc0, p, SHORT, t.shiftShort);
+            p += 3 * SHORT;
+            len -= 3 * SHORT;
+        }
+        for (; len >= 8; len -= 8, p += 8) {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            crc0 = _mm_crc32_u64(crc0, word);
+        }
+        for (; len > 0; --len, ++p)
+            crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *p);
+        return (static_cast<uint32_t>(crc0));
+    }
+
+    __attribute__((target("sse4.2")))
+    static uint64_t stripes(uint64_t crc0, const unsigned char *p, std::size_t size, const uint32_t table[4][256])
+    {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+
+        for (const unsigned char *end = p + size; p < end; p += 8) {
+            uint64_t w0, w1, w2;
+            std::memcpy(&w0, p, 8);
+            std::memcpy(&w1, p + size, 8);
+            std::memcpy(&w2, p + 2 * size, 8);
+            crc0 = _mm_crc32_u64(crc0, w0);
+            crc1 = _mm_crc32_u64(crc1, w1);
+            crc2 = _mm_crc32_u64(crc2, w2);
+        }
+        crc0 = shift(table, static_cast<uint32_t>(crc0)) ^ crc1;
+        return (shift(table, static_cast<uint32_t>(crc0)) ^ crc2);
+    }
+#endif
+};
@@ -0,0 +1,87 @@
+/*
+* LibSocket C++ binding
+* Header-only byte order conversions
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @brief Byte order
+ */
+enum class Endian {
+    Little,
+    Big,
+    Native = (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) ? Big : Little
+};
+
+/**
+ * @brief Conversions between native values and bytes of a given byte order
+ * Conversions to the native order compile to plain loads and stores, others
+ * to a single byte-swap instruction.
+ */
+struct ByteOrder
+{
+    /**
+     * @brief Reverse the bytes of an unsigned integer
+     * @param value value to swap
+     */
+    template <typename U>
+    static constexpr U swap(U value)
+    {
+        static_assert(std::is_unsigned<U>::value, "swap requires an unsigned type");
+        if constexpr (sizeof(U) == 1)
+            return (value);
+        else if constexpr (sizeof(U) == 2)
+            return (__builtin_bswap16(value));
+        else if constexpr (sizeof(U) == 4)
+            return (__builtin_bswap32(value));
+        else
+            return (__builtin_bswap64(value));
+    }
+
+    /**
+     * @brief Store an arithmetic value as bytes of the given order
+     * @param dst destination, sizeof(T) bytes
+     * @param value value to store
+     */
+    template <Endian E, typename T>
+    static inline void store(char *dst, T value)
+    {
+        using U = typename Bits<sizeof(T)>::type;
+        static_assert(std::is_arithmetic<T>::value, "store requires an arithmetic type");
+        U bits;
+        std::memcpy(&bits, &value, sizeof(T));
+        if constexpr (E != Endian::Native)
+            bits = swap(bits);
+        std::memcpy(dst, &bits, sizeof(T));
+    }
+    /**
+     * @brief Load an arithmetic value from bytes of the given order
+     * @param src source, sizeof(T) bytes
+     */
+    template <Endian E, typename T>
+    static inline T load(const char *src)
+    {
+        using U = typename Bits<sizeof(T)>::type;
+        static_assert(std::is_arithmetic<T>::value, "load requires an arithmetic type");
+        U bits;
+        T value;
+        std::memcpy(&bits, src, sizeof(T));
+        if constexpr (E != Endian::Native)
+            bits = swap(bits);
+        std::memcpy(&value, &bits, sizeof(T));
+        return (value);
+    }
+
+private:
+    template <std::size_t N> struct Bits;
+};
+
+template <> struct ByteOrder::Bits<1> { using type = uint8_t; };
+template <> struct ByteOrder::Bits<2> { using type = uint16_t; };
+template <> struct ByteOrder::Bits<4> { using type = uint32_t; };
+template <> struct ByteOrder::Bits<8> { using type = uint64_t; };
@@ -0,0 +1,599 @@
+/*
+* LibSocket C++ binding
+* Header-only endpoint parsing and socket addresses
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * @brief Endpoint text parsed without allocating, usable in constant expressions
+ * Accepted forms are "host:port", "1.2.3.4:port", "[v6]:port", a bare IPv4
+ * or IPv6 address or host name (port 0), ":port" (IPv4 any address), and Unix
+ * socket paths, either absolute, relative starting with '.', or prefixed with
+ * "unix:". Host names and paths are views into the parsed text.
+ */
+struct ParsedEndpoint
+{
+    enum Kind : uint8_t { Ipv4, Ipv6, Host, Unix };
+
+    enum Error : uint8_t {
+        None,
+        Empty,
+        BadIpv4,
+        BadIpv6,
+        BadZone,
+        UnclosedBracket,
+        BadHost,
+        HostTooLong,
+        PathTooLong,
+        MissingPort,
+        BadPort,
+        PortRange,
+        TrailingData,
+        Unresolved
+    };
+
+    /**
+     * @brief Maximum length of a host name
+     */
+    static constexpr std::size_t MAX_HOST = 253;
+    /**
+     * @brief Maximum length of a Unix socket path, sun_path minus the terminator
+     */
+    static constexpr std::size_t MAX_PATH = 107;
+
+    Kind kind{ Host };
+    Error error{ None };
+    /**
+     * @brief Offset in the text where parsing failed
+     */
+    std::size_t where{ 0 };
+    /**
+     * @brief Port in host byte order, 0 if absent
+     */
+    uint16_t port{ 0 };
+    /**
+     * @brief Address in network byte order, 4 bytes for IPv4, 16 for IPv6
+     */
+    uint8_t addr[16]{};
+    /**
+     * @brief IPv6 numeric zone index ("%2"), 0 if absent
+     */
+    uint32_t scope{ 0 };
+    /**
+     * @brief Host name or Unix socket path
+     */
+    std::string_view host;
+
+    constexpr bool ok() const
+    {
+        return (error == None);
+    }
+
+    /**
+     * @brief Parse an endpoint
+     * @param text endpoint text, must outlive the result for host names and paths
+     */
+    static constexpr ParsedEndpoint parse(std::string_view text)
+    {
+        ParsedEndpoint ep;
+        std::size_t colon = text.find(':');
+
+        if (text.empty())
+            return (ep.fail(Empty, 0));
+        if (text.substr(0, 5) == "unix:")
+            return (ep.parsePath(text.substr(5), 5));
+        if (text[0] == '/' || text[0] == '.')
+            return (ep.parsePath(text, 0));
+        if (text[0] == '[') {
+            std::size_t close = text.find(']');
+            if (close == std::string_view::npos)
+                return (ep.fail(UnclosedBracket, text.size()));
+            if (!ep.parseIpv6(text.substr(1, close - 1), 1))
+                return (ep);
+            if (close + 1 == text.size())
+                return (ep);
+            if (text[close + 1] != ':')
+                return (ep.fail(TrailingData, close + 1));
+            ep.parsePort(text.substr(close + 2), close + 2);
+            return (ep);
+        }
+        if (colon != std::string_view::npos && text.find(':', colon + 1) != std::string_view::npos) {
+            ep.parseIpv6(text, 0);
+            return (ep);
+        }
+        std::string_view name = text.substr(0, colon);
+        if (name.empty())
+            ep.kind = Ipv4;
+        else if (name.find_first_not_of("0123456789.") == std::string_view::npos)
+            ep.parseIpv4(name, 0, ep.addr);
+        else
+            ep.parseHost(name, 0);
+        if (ep.ok() && colon != std::string_view::npos)
+            ep.parsePort(text.substr(colon + 1), colon + 1);
+        return (ep);
+    }
+
+    /**
+     * @brief Describe a parse error
+     */
+    static constexpr const char *strerror(Error error)
+    {
+        switch (error) {
+        case None: return ("success");
+        case Empty: return ("empty endpoint");
+        case BadIpv4: return ("invalid IPv4 address");
+        case BadIpv6: return ("invalid IPv6 address");
+        case BadZone: return ("invalid IPv6 zone index");
+        case UnclosedBracket: return ("missing ']'");
+        case BadHost: return ("invalid host name");
+        case HostTooLong: return ("host name too long");
+        case PathTooLong: return ("Unix socket path too long");
+        case MissingPort: return ("missing port after ':'");
+        case BadPort: return ("invalid port");
+        case PortRange: return ("port out of range");
+        case TrailingData: return ("unexpected characters after address");
+        case Unresolved: return ("host name not resolved");
+        }
+        return ("unknown error");
+    }
+
+private:
+    constexpr ParsedEndpoint &fail(Error err, std::size_t pos)
+    {
+        error = err;
+        where = pos;
+        return (*this);
+    }
+
+    static constexpr int hexValue(char c)
+    {
+        return (c >= '0' && c <= '9' ? c - '0'
+                : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1);
+    }
+
+    constexpr ParsedEndpoint &parsePath(std::string_view path, std::size_t base)
+    {
+        kind = Unix;
+        host = path;
+        if (path.empty())
+            return (this->fail(Empty, base));
+        if (path.size() > MAX_PATH)
+            return (this->fail(PathTooLong, base + MAX_PATH));
+        return (*this);
+    }
+
+    /**
+     * @brief Parse a strict dotted quad: four decimal parts, no leading zeros
+     */
+    constexpr bool parseIpv4(std::string_view text, std::size_t base, uint8_t *out)
+    {
+        unsigned value = 0;
+        int digits = 0;
+        int part = 0;
+
+        kind = Ipv4;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if (c >= '0' && c <= '9') {
+                value = value * 10 + (c - '0');
+                if ((digits > 0 && value < 10) || value > 255) {
+                    this->fail(BadIpv4, base + i);
+                    return (false);
+                }
+                ++digits;
+            } else if (c == '.' && digits > 0 && part < 3) {
+                out[part++] = static_cast<uint8_t>(value);
+                value = 0;
+                digits = 0;
+            } else {
+                this->fail(BadIpv4, base + i);
+                return (false);
+            }
+        }
+        if (digits == 0 || part != 3) {
+            this->fail(BadIpv4, base + text.size());
+            return (false);
+        }
+        out[3] = static_cast<uint8_t>(value);
+        return (true);
+    }
+
+    /**
+     * @brief Parse an IPv6 address (RFC 4291 section 2.2) with an optional numeric zone
+     */
+    constexpr bool parseIpv6(std::string_view text, std::size_t base)
+    {
+        uint16_t groups[8]{};
+        int count = 0;
+        int gap = -1;
+        std::size_t i = 0;
+        std::size_t percent = text.find('%');
+
+        kind = Ipv6;
+        if (percent != std::string_view::npos) {
+            std::string_view zone = text.substr(percent + 1);
+            if (zone.empty() || zone.size() > 9 || zone.find_first_not_of("0123456789") != std::string_view::npos) {
+                this->fail(BadZone, base + percent + 1);
+                return (false);
+            }
+            for (char c : zone)
+                scope = scope * 10 + (c - '0');
+            text = text.substr(0, percent);
+        }
+        if (text.substr(0, 2) == "::") {
+            gap = 0;
+            i = 2;
+        }
+        while (i < text.size()) {
+            std::size_t start = i;
+            unsigned value = 0;
+            while (i < text.size() && i - start < 5 && hexValue(text[i]) >= 0)
+                value = value * 16 + hexValue(text[i++]);
+            if (i < text.size() && text[i] == '.' && count <= 6) {
+                uint8_t quad[4]{};
+                if (!this->parseIpv4(text.substr(start), base + start, quad)) {
+                    error = BadIpv6;
+                    return (false);
+                }
+                kind = Ipv6;
+                groups[count++] = static_cast<uint16_t>(quad[0] << 8 | quad[1]);
+                groups[count++] = static_cast<uint16_t>(quad[2] << 8 | quad[3]);
+                i = text.size();
+                break;
+            }
+            if (i == start || i - start > 4 || count == 8) {
+                this->fail(BadIpv6, base + (count == 8 ? start : std::min(i, start + 4)));
+                return (false);
+            }
+            groups[count++] = static_cast<uint16_t>(value);
+            if (i == text.size())
+                break;
+            if (text[i] != ':' || i + 1 == text.size()) {
+                this->fail(BadIpv6, base + i);
+                return (false);
+            }
+            if (text[++i] == ':') {
+                if (gap >= 0) {
+                    this->fail(BadIpv6, base + i);
+                    return (false);
+                }
+                gap = count;
+                ++i;
+            }
+        }
+        if ((gap < 0 && count != 8) || (gap >= 0 && count > 7)) {
+            this->fail(BadIpv6, base + text.size());
+            return (false);
+        }
+        int tail = gap < 0 ? 0 : count - gap;
+        for (int k = 0; k < count; ++k) {
+            int pos = (gap < 0 || k < gap) ? k : 8 - tail + (k - gap);
+            addr[2 * pos] = static_cast<uint8_t>(groups[k] >> 8);
+            addr[2 * pos + 1] = static_cast<uint8_t>(groups[k]);
+        }
+        return (true);
+    }
+
+    /**
+     * @brief Validate a host name: dot-separated labels of letters, digits, '-' and '_'
+     */
+    constexpr bool parseHost(std::string_view text, std::size_t base)
+    {
+        std::size_t label = 0;
+
+        kind = Host;
+        host = text;
+        if (text.size() > MAX_HOST) {
+            this->fail(HostTooLong, base + MAX_HOST);
+            return (false);
+        }
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            bool alnum = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+            if (c == '.' && label > 0 && text[i - 1] != '-') {
+                label = 0;
+            } else if (alnum || (c == '-' && label > 0)) {
+                if (++label > 63) {
+                    this->fail(BadHost, base + i);
+                    return (false);
+                }
+            } else {
+                this->fail(BadHost, base + i);
+                return (false);
+            }
+        }
+        if (text.back() == '-') {
+            this->fail(BadHost, base + text.size() - 1);
+            return (false);
+        }
+        return (true);
+    }
+
+    constexpr bool parsePort(std::string_view text, std::size_t base)
+    {
+        uint32_t value = 0;
+
+        if (text.empty()) {
+            this->fail(MissingPort, base);
+            return (false);
+        }
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            if (text[i] < '0' || text[i] > '9') {
+                this->fail(i == 0 ? BadPort : TrailingData, base + i);
+                return (false);
+            }
+            value = value * 10 + (text[i] - '0');
+            if (value > 65535) {
+                this->fail(PortRange, base);
+                return (false);
+            }
+        }
+        port = static_cast<uint16_t>(value);
+        return (true);
+    }
+};
+
+/**
+ * @brief Reached when an invalid "..."_endpoint literal is evaluated
+ * Not constexpr, so an invalid literal in a constant expression fails to
+ * compile.
+ */
+inline ParsedEndpoint invalid_endpoint_literal(ParsedEndpoint ep)
+{
+    return (ep);
+}
+
+/**
+ * @brief Endpoint literal, e.g. constexpr ParsedEndpoint ep = "[::1]:8080"_endpoint;
+ */
+constexpr ParsedEndpoint operator""_endpoint(const char *text, std::size_t len)
+{
+    ParsedEndpoint ep = ParsedEndpoint::parse(std::string_view(text, len));
+    return (ep.ok() ? ep : invalid_endpoint_literal(ep));
+}
+
+/**
+ * @brief Socket address of any family, with the port in host byte order
+ * The sockaddr form is built once at construction, so an Endpoint can be
+ * passed to listen() and connect() repeatedly without conversions.
+ */
+class Endpoint
+{
+private:
+    struct sockaddr_storage _addr{};
+    socklen_t _len{ 0 };
+    ParsedEndpoint::Error _error{ ParsedEndpoint::Empty };
+
+public:
+    /**
+     * @brief Construct an invalid endpoint
+     */
+    Endpoint() = default;
+    /**
+     * @brief Construct an endpoint from a socket address
+     * @param addr address, AF_INET, AF_INET6 or AF_UNIX
+     * @param addrlen size of the address
+     */
+    Endpoint(const struct sockaddr *addr, socklen_t addrlen)
+    {
+        if (addrlen <= sizeof(_addr) && addrlen >= sizeof(sa_family_t)) {
+            std::memcpy(&_addr, addr, addrlen);
+            _len = addrlen;
+            _error = ParsedEndpoint::None;
+        }
+    }
+    /**
+     * @brief Construct an endpoint from a resolved address, e.g. from Resolver
+     * @param addr address, its port is replaced
+     * @param port port in host byte order
+     */
+    Endpoint(const struct sockaddr_storage &addr, uint16_t port)
+        : Endpoint(reinterpret_cast<const struct sockaddr *>(&addr),
+                   addr.ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in))
+    {
+        this->setPort(port);
+    }
+    /**
+     * @brief Construct an endpoint from parsed text
+     * Host names must be resolved first and give an invalid endpoint with
+     * error() set to Unresolved.
+     * @param ep parse result
+     */
+    Endpoint(const ParsedEndpoint &ep)
+    {
+        _error = ep.error;
+        if (!ep.ok())
+            return;
+        if (ep.kind == ParsedEndpoint::Ipv4) {
+            auto &sin = reinterpret_cast<struct sockaddr_in &>(_addr);
+            sin.sin_family = AF_INET;
+            sin.sin_port = htons(ep.port);
+            std::memcpy(&sin.sin_addr, ep.addr, 4);
+            _len = sizeof(sin);
+        } else if (ep.kind == ParsedEndpoint::Ipv6) {
+            auto &sin6 = reinterpret_cast<struct sockaddr_in6 &>(_addr);
+            sin6.sin6_family = AF_INET6;
+            sin6.sin6_port = htons(ep.port);
+            std::memcpy(&sin6.sin6_addr, ep.addr, 16);
+            sin6.sin6_scope_id = ep.scope;
+            _len = sizeof(sin6);
+        } else if (ep.kind == ParsedEndpoint::Unix) {
+            *this = local(ep.host);
+        } else {
+            _error = ParsedEndpoint::Unresolved;
+        }
+    }
+    /**
+     * @brief Parse an endpoint, see ParsedEndpoint for the accepted forms
+     * @param text endpoint text, host names are not resolved
+     */
+    explicit Endpoint(std::string_view text)
+        : Endpoint(ParsedEndpoint::parse(text))
+    {
+    }
+
+    /**
+     * @brief IPv4 endpoint
+     * @param addr address in host byte order, e.g. INADDR_LOOPBACK
+     * @param port port in host byte order
+     */
+    static Endpoint ipv4(uint32_t addr, uint16_t port)
+    {
+        struct sockaddr_in sin = {};
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons(port);
+        sin.sin_addr.s_addr = htonl(addr);
+        return (Endpoint(reinterpret_cast<const struct sockaddr *>(&sin), sizeof(sin)));
+    }
+    /**
+     * @brief IPv6 endpoint
+     * @param addr address, e.g. in6addr_loopback
+     * @param port port in host byte order
+     * @param scope zone index for link-local addresses
+     */
+    static Endpoint ipv6(const struct in6_addr &addr, uint16_t port, uint32_t scope = 0)
+    {
+        struct sockaddr_in6 sin6 = {};
+        sin6.sin6_family = AF_INET6;
+        sin6.sin6_port = htons(port);
+        sin6.sin6_addr = addr;
+        sin6.sin6_scope_id = scope;
+        return (Endpoint(reinterpret_cast<const struct sockaddr *>(&sin6), sizeof(sin6)));
+    }
+    /**
+     * @brief Unix domain socket endpoint
+     * @param path socket path, at most ParsedEndpoint::MAX_PATH bytes
+     */
+    static Endpoint local(std::string_view path)
+    {
+        struct sockaddr_un sa = {};
+        Endpoint ep;
+
+        if (path.empty() || path.size() > ParsedEndpoint::MAX_PATH) {
+            ep._error = path.empty() ? ParsedEndpoint::Empty : ParsedEndpoint::PathTooLong;
+            return (ep);
+        }
+        sa.sun_family = AF_UNIX;
+        path.copy(sa.sun_path, path.size());
+        return (Endpoint(reinterpret_cast<const struct sockaddr *>(&sa),
+                         offsetof(struct sockaddr_un, sun_path) + path.size() + 1));
+    }
+    /**
+     * @brief Wildcard endpoint to listen on every interface
+     * @param port port in host byte order
+     * @param family AF_INET or AF_INET6
+     */
+    static Endpoint any(uint16_t port, int family = AF_INET)
+    {
+        return (family == AF_INET6 ? ipv6(in6addr_any, port) : ipv4(INADDR_ANY, port));
+    }
+    /**
+     * @brief Loopback endpoint
+     * @param port port in host byte order
+     * @param family AF_INET or AF_INET6
+     */
+    static Endpoint loopback(uint16_t port, int family = AF_INET)
+    {
+        return (family == AF_INET6 ? ipv6(in6addr_loopback, port) : ipv4(INADDR_LOOPBACK, port));
+    }
+
+    /**
+     * @brief Check whether the endpoint holds an address
+     */
+    inline bool valid() const
+    {
+        return (_len != 0);
+    }
+    /**
+     * @brief Get the reason the endpoint is invalid
+     */
+    inline ParsedEndpoint::Error error() const
+    {
+        return (_error);
+    }
+    /**
+     * @brief Get the address family, AF_UNSPEC if invalid
+     */
+    inline int family() const
+    {
+        return (_len != 0 ? _addr.ss_family : AF_UNSPEC);
+    }
+    /**
+     * @brief Get the port in host byte order, 0 for Unix sockets
+     */
+    uint16_t port() const
+    {
+        if (_addr.ss_family == AF_INET)
+            return (ntohs(reinterpret_cast<const struct sockaddr_in &>(_addr).sin_port));
+        if (_addr.ss_family == AF_INET6)
+            return (ntohs(reinterpret_cast<const struct sockaddr_in6 &>(_addr).sin6_port));
+        return (0);
+    }
+    /**
+     * @brief Change the port
+     * @param port port in host byte order
+     */
+    void setPort(uint16_t port)
+    {
+        if (_addr.ss_family == AF_INET)
+            reinterpret_cast<struct sockaddr_in &>(_addr).sin_port = htons(port);
+        else if (_addr.ss_family == AF_INET6)
+            reinterpret_cast<struct sockaddr_in6 &>(_addr).sin6_port = htons(port);
+    }
+    /**
+     * @brief Get the socket address
+     */
+    inline const struct sockaddr *addr() const
+    {
+        return (reinterpret_cast<const struct sockaddr *>(&_addr));
+    }
+    /**
+     * @brief Get the size of the socket address
+     */
+    inline socklen_t length() const
+    {
+        return (_len);
+    }
+
+    /**
+     * @brief Format as "1.2.3.4:80", "[::1]:80" or "unix:/path"
+     */
+    std::string toString() const
+    {
+        char buf[INET6_ADDRSTRLEN] = "";
+
+        if (_addr.ss_family == AF_INET) {
+            inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in &>(_addr).sin_addr, buf, sizeof(buf));
+            return (std::string(buf) + ':' + std::to_string(this->port()));
+        }
+        if (_addr.ss_family == AF_INET6) {
+            inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6 &>(_addr).sin6_addr, buf, sizeof(buf));
+            return ('[' + std::string(buf) + "]:" + std::to_string(this->port()));
+        }
+        if (_addr.ss_family == AF_UNIX && _len > offsetof(struct sockaddr_un, sun_path))
+            return ("unix:" + std::string(reinterpret_cast<const struct sockaddr_un &>(_addr).sun_path));
+        return (std::string());
+    }
+
+    bool operator==(const Endpoint &other) const
+    {
+        return (_len == other._len && std::memcmp(&_addr, &other._addr, _len) == 0);
+    }
+    bool operator!=(const Endpoint &other) const
+    {
+        return (!(*this == other));
+    }
+};
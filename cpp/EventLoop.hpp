@@ -0,0 +1,369 @@
+/*
+* LibSocket C++ binding
+* Header-only epoll event loop
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/**
+ * @brief Multi-producer single-consumer queue of tasks, lock-free on both sides
+ * Producers push onto an atomic list head; the consumer takes the whole list
+ * at once and runs it in posting order.
+ */
+class TaskQueue
+{
+public:
+    using Task = std::function<void()>;
+
+private:
+    struct Node
+    {
+        Task task;
+        Node *next;
+    };
+
+    std::atomic<Node *> _head{ nullptr };
+
+public:
+    TaskQueue() = default;
+    TaskQueue(const TaskQueue &) = delete;
+    TaskQueue &operator=(const TaskQueue &) = delete;
+    ~TaskQueue()
+    {
+        Node *node = _head.exchange(nullptr);
+        while (node != nullptr) {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    /**
+     * @brief Add a task, may be called from any thread
+     */
+    void push(Task task)
+    {
+        Node *node = new Node{ std::move(task), _head.load(std::memory_order_relaxed) };
+        while (!_head.compare_exchange_weak(node->next, node))
+            ;
+    }
+    /**
+     * @brief Check if no task is queued
+     */
+    inline bool empty() const
+    {
+        return (_head.load() == nullptr);
+    }
+    /**
+     * @brief Run the queued tasks, from the consumer thread only
+     * Tasks pushed meanwhile, including by the tasks themselves, wait for the
+     * next call.
+     * @return number of tasks run
+     */
+    std::size_t run()
+    {
+        Node *node = _head.exchange(nullptr, std::memory_order_acquire);
+        Node *ordered = nullptr;
+        std::size_t count = 0;
+
+        while (node != nullptr) {
+            Node *next = node->next;
+            node->next = ordered;
+            ordered = node;
+            node = next;
+        }
+        while (ordered != nullptr) {
+            std::unique_ptr<Node> done(ordered);
+            ordered = ordered->next;
+            done->task();
+            ++count;
+        }
+        return (count);
+    }
+};
+
+/**
+ * @brief eventfd(2) waking a thread blocked in epoll_wait(2), with coalescing
+ * The waiting thread calls arm() before blocking and then re-checks for work,
+ * and disarm() once awake. notify() only writes to the eventfd when armed,
+ * and only the first notify() after arm() does, so wakeups of a busy thread
+ * cost no system call.
+ */
+class Notifier
+{
+private:
+    int _fd{ -1 };
+    std::atomic<bool> _armed{ false };
+    std::atomic<uint64_t> _writes{ 0 };
+
+public:
+    Notifier()
+        : _fd{ eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) }
+    {
+    }
+    Notifier(const Notifier &) = delete;
+    Notifier &operator=(const Notifier &) = delete;
+    ~Notifier()
+    {
+        if (_fd != -1)
+            ::close(_fd);
+    }
+
+    inline bool good() const
+    {
+        return (_fd != -1);
+    }
+    /**
+     * @brief Descriptor to watch for EPOLLIN
+     */
+    inline int fd() const
+    {
+        return (_fd);
+    }
+    /**
+     * @brief Number of eventfd writes so far
+     */
+    inline uint64_t writes() const
+    {
+        return (_writes.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Announce that the calling thread is about to block
+     * Sequentially consistent, so that either the caller's following check
+     * sees work published before a notify(), or that notify() sees the flag.
+     */
+    inline void arm()
+    {
+        _armed.store(true);
+    }
+    /**
+     * @brief Announce that the calling thread is awake
+     */
+    inline void disarm()
+    {
+        _armed.store(false, std::memory_order_relaxed);
+    }
+    /**
+     * @brief Wake the thread if it may be blocked, may be called from any thread
+     */
+    void notify()
+    {
+        if (!_armed.load() || !_armed.exchange(false))
+            return;
+        uint64_t one = 1;
+        _writes.fetch_add(1, std::memory_order_relaxed);
+        (void)!::write(_fd, &one, sizeof(one));
+    }
+    /**
+     * @brief Reset the eventfd counter once it reported readable
+     */
+    void drain()
+    {
+        uint64_t count = 0;
+        (void)!::read(_fd, &count, sizeof(count));
+    }
+};
+
+/**
+ * @brief Readiness-based event loop dispatching epoll(7) events to callbacks
+ */
+class EventLoop
+{
+public:
+    /**
+     * @brief Event callback, receives the ready epoll event mask
+     */
+    using Callback = std::function<void(uint32_t events)>;
+
+    /**
+     * @brief Maximum number of events dispatched per epoll_wait(2) call
+     */
+    static constexpr int MAX_EVENTS = 256;
+
+private:
+    int _epfd{ -1 };
+    int _errno{ 0 };
+    std::atomic<bool> _running{ false };
+    std::unordered_map<int, std::shared_ptr<Callback>> _handlers;
+    Notifier _notifier;
+    TaskQueue _tasks;
+
+public:
+    /**
+     * @brief Construct a new event loop
+     */
+    EventLoop()
+        : _epfd{ epoll_create1(EPOLL_CLOEXEC) }
+    {
+        _errno = errno;
+        if (_epfd != -1 && !this->add(_notifier.fd(), EPOLLIN, [this](uint32_t) { _notifier.drain(); })) {
+            ::close(_epfd);
+            _epfd = -1;
+        }
+    }
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+    ~EventLoop()
+    {
+        if (_epfd != -1)
+            ::close(_epfd);
+    }
+
+    /**
+     * @brief Check if the loop was successfully created
+     */
+    inline bool good() const
+    {
+        return (_epfd != -1);
+    }
+    /**
+     * @brief Get last error code
+     */
+    inline int errcode() const
+    {
+        return (_errno);
+    }
+
+    /**
+     * @brief Watch a descriptor for events
+     * @param fd descriptor to watch
+     * @param events epoll event mask (EPOLLIN, EPOLLOUT, ...)
+     * @param cb callback invoked when the descriptor is ready
+     */
+    bool add(int fd, uint32_t events, Callback cb)
+    {
+        struct epoll_event ev = {};
+        ev.events = events;
+        ev.data.fd = fd;
+
+        if (epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            _errno = errno;
+            return (false);
+        }
+        _handlers[fd] = std::make_shared<Callback>(std::move(cb));
+        return (true);
+    }
+    /**
+     * @brief Change the events watched on a descriptor
+     * @param fd watched descriptor
+     * @param events new epoll event mask
+     */
+    bool modify(int fd, uint32_t events)
+    {
+        struct epoll_event ev = {};
+        ev.events = events;
+        ev.data.fd = fd;
+
+        if (epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+            _errno = errno;
+            return (false);
+        }
+        return (true);
+    }
+    /**
+     * @brief Stop watching a descriptor
+     * Safe to call from within the descriptor's own callback.
+     * @param fd watched descriptor
+     */
+    bool remove(int fd)
+    {
+        _handlers.erase(fd);
+        if (epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, nullptr) == -1) {
+            _errno = errno;
+            return (false);
+        }
+        return (true);
+    }
+
+    /**
+     * @brief Run a task on the loop thread, may be called from any thread
+     * Wakes the loop only if it may be blocked in epoll_wait(2), so posting to
+     * a busy loop costs no system call.
+     */
+    void post(TaskQueue::Task task)
+    {
+        _tasks.push(std::move(task));
+        _notifier.notify();
+    }
+    /**
+     * @brief Hand a watched descriptor over to another loop
+     * Stops watching 'fd' here and posts 'adopt' to 'target', whose thread
+     * runs it and watches the descriptor there. Call from this loop's thread,
+     * outside the descriptor's own callback. Epoll is level-triggered, so data
+     * arriving in between is reported by the target.
+     * @return false if 'fd' was not watched here, 'adopt' is posted anyway
+     */
+    bool migrate(int fd, EventLoop &target, TaskQueue::Task adopt)
+    {
+        bool ok = this->remove(fd);
+        target.post(std::move(adopt));
+        return (ok);
+    }
+    /**
+     * @brief Get the loop's wakeup notifier, for its counters
+     */
+    inline const Notifier &notifier() const
+    {
+        return (_notifier);
+    }
+
+    /**
+     * @brief Wait for events once and dispatch them, then run posted tasks
+     * @param timeout maximum wait in milliseconds, -1 to wait indefinitely
+     * @return number of dispatched events, -1 on error
+     */
+    int runOnce(int timeout)
+    {
+        struct epoll_event events[MAX_EVENTS];
+
+        if (timeout != 0) {
+            _notifier.arm();
+            if (!_tasks.empty())
+                timeout = 0;
+        }
+        int count = epoll_wait(_epfd, events, MAX_EVENTS, timeout);
+        _notifier.disarm();
+        if (count == -1) {
+            _errno = errno;
+            return (_errno == EINTR ? 0 : -1);
+        }
+        for (int i = 0; i < count; ++i) {
+            auto it = _handlers.find(events[i].data.fd);
+            if (it == _handlers.end())
+                continue;
+            std::shared_ptr<Callback> cb = it->second;
+            (*cb)(events[i].events);
+        }
+        _tasks.run();
+        return (count);
+    }
+    /**
+     * @brief Dispatch events until stop() is called
+     * @param timeout interval in milliseconds at which the stop flag is checked
+     */
+    void run(int timeout = 100)
+    {
+        _running = true;
+        while (_running && this->runOnce(timeout) != -1)
+            ;
+    }
+    /**
+     * @brief Request run() to return, may be called from any thread
+     */
+    void stop()
+    {
+        _running = false;
+        _notifier.notify();
+    }
+};
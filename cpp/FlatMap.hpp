@@ -0,0 +1,171 @@
+/*
+* LibSocket C++ binding
+* Header-only open-addressing hash map keyed by integers
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Open-addressing hash map from non-zero 64-bit keys to values
+ * Linear probing over a power-of-two table with backward-shift deletion, so
+ * lookups touch contiguous memory and erasing leaves no tombstones.
+ */
+template <typename T>
+class FlatMap
+{
+private:
+    struct Slot
+    {
+        uint64_t key{ 0 };
+        T value{};
+    };
+
+    std::vector<Slot> _slots;
+    std::size_t _size{ 0 };
+    std::size_t _mask{ 0 };
+
+public:
+    /**
+     * @brief Construct a map able to hold 'capacity' entries without growing
+     * @param capacity expected number of entries
+     */
+    FlatMap(std::size_t capacity = 16)
+    {
+        this->rehash(capacity * 2);
+    }
+
+    /**
+     * @brief Insert or replace a value
+     * @param key non-zero key
+     * @param value value to store
+     */
+    void insert(uint64_t key, T value)
+    {
+        if ((_size + 1) * 2 > _slots.size())
+            this->rehash(_slots.size() * 2);
+        std::size_t i = this->slot(key);
+        if (_slots[i].key == 0)
+            ++_size;
+        _slots[i].key = key;
+        _slots[i].value = std::move(value);
+    }
+    /**
+     * @brief Find a value
+     * @param key non-zero key
+     * @return pointer to the value, or nullptr if the key is missing
+     */
+    T *find(uint64_t key)
+    {
+        std::size_t i = this->slot(key);
+        return (_slots[i].key == key ? &_slots[i].value : nullptr);
+    }
+    /**
+     * @brief Remove a value, moving it out
+     * @param key non-zero key
+     * @param value set to the removed value
+     * @return false if the key is missing
+     */
+    bool take(uint64_t key, T &value)
+    {
+        std::size_t i = this->slot(key);
+        if (_slots[i].key != key)
+            return (false);
+        value = std::move(_slots[i].value);
+        this->eraseSlot(i);
+        return (true);
+    }
+    /**
+     * @brief Remove a value
+     * @param key non-zero key
+     * @return false if the key is missing
+     */
+    bool erase(uint64_t key)
+    {
+        T value;
+        return (this->take(key, value));
+    }
+
+    /**
+     * @brief Call a function on every entry
+     * @param fn function taking the key and a reference to the value
+     */
+    template <typename Fn>
+    void forEach(Fn fn)
+    {
+        for (Slot &s : _slots)
+            if (s.key != 0)
+                fn(s.key, s.value);
+    }
+    /**
+     * @brief Remove all entries
+     */
+    void clear()
+    {
+        for (Slot &s : _slots)
+            s = Slot();
+        _size = 0;
+    }
+
+    /**
+     * @brief Number of entries
+     */
+    inline std::size_t size() const
+    {
+        return (_size);
+    }
+
+private:
+    static inline std::size_t hash(uint64_t key)
+    {
+        return (static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> 32));
+    }
+
+    /**
+     * @brief Find the slot holding a key, or the empty slot ending its probe sequence
+     */
+    std::size_t slot(uint64_t key) const
+    {
+        std::size_t i = hash(key) & _mask;
+        while (_slots[i].key != 0 && _slots[i].key != key)
+            i = (i + 1) & _mask;
+        return (i);
+    }
+
+    /**
+     * @brief Empty a slot, shifting back entries displaced past it
+     */
+    void eraseSlot(std::size_t i)
+    {
+        std::size_t j = i;
+        while (true) {
+            j = (j + 1) & _mask;
+            if (_slots[j].key == 0)
+                break;
+            std::size_t home = hash(_slots[j].key) & _mask;
+            if (((j - home) & _mask) >= ((j - i) & _mask)) {
+                _slots[i] = std::move(_slots[j]);
+                i = j;
+            }
+        }
+        _slots[i] = Slot();
+        --_size;
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        std::size_t size = 16;
+        while (size < capacity)
+            size *= 2;
+        std::vector<Slot> old = std::move(_slots);
+        _slots = std::vector<Slot>(size);
+        _mask = size - 1;
+        _size = 0;
+        for (Slot &s : old)
+            if (s.key != 0)
+                this->insert(s.key, std::move(s.value));
+    }
+};
@@ -0,0 +1,177 @@
+/*
+* LibSocket C++ binding
+* Header-only length-prefixed message framing
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "Crc32c.hpp"
+#include "Endian.hpp"
+
+/**
+ * @brief Length-prefixed framing: a 32-bit big-endian payload size, then the payload
+ * Checksummed frames are followed by the big-endian CRC32C of their payload.
+ */
+class Frame
+{
+public:
+    /**
+     * @brief Result of a parse call
+     */
+    enum Status { Complete, Incomplete, Invalid };
+
+    /**
+     * @brief Size of the frame header
+     */
+    static constexpr std::size_t HEADER_SIZE = 4;
+    /**
+     * @brief Size of the checksum trailer
+     */
+    static constexpr std::size_t CHECKSUM_SIZE = 4;
+    /**
+     * @brief Maximum payload size
+     */
+    static constexpr uint32_t MAX_SIZE = 16 << 20;
+
+    /**
+     * @brief Parse one frame from the front of a buffer
+     * @param data buffer holding received data
+     * @param len number of bytes in the buffer
+     * @param payload set to a view of the frame payload when complete
+     * @param consumed set to the size of the frame in the buffer when complete
+     */
+    static Status parse(const char *data, std::size_t len, std::string_view &payload, std::size_t &consumed)
+    {
+        if (len < HEADER_SIZE)
+            return (Incomplete);
+        uint32_t size = ByteOrder::load<Endian::Big, uint32_t>(data);
+        if (size > MAX_SIZE)
+            return (Invalid);
+        if (len - HEADER_SIZE < size)
+            return (Incomplete);
+        payload = std::string_view(data + HEADER_SIZE, size);
+        consumed = HEADER_SIZE + size;
+        return (Complete);
+    }
+
+    /**
+     * @brief Start a frame at the end of an output buffer
+     * Append the payload, then call end() with the returned offset.
+     * @param out output buffer
+     * @return offset of the frame in the output buffer
+     */
+    static std::size_t begin(std::string &out)
+    {
+        std::size_t offset = out.size();
+        out.append(HEADER_SIZE, '\0');
+        return (offset);
+    }
+    /**
+     * @brief Complete a frame started with begin()
+     * A payload larger than MAX_SIZE, which readers would reject, is removed
+     * from the output buffer along with its header.
+     * @param out output buffer
+     * @param offset offset returned by begin()
+     * @param checksum append the CRC32C of the payload
+     * @return false if the payload was too large
+     */
+    static bool end(std::string &out, std::size_t offset, bool checksum = false)
+    {
+        if (out.size() - offset - HEADER_SIZE > MAX_SIZE) {
+            out.resize(offset);
+            return (false);
+        }
+        uint32_t size = out.size() - offset - HEADER_SIZE;
+        ByteOrder::store<Endian::Big>(&out[offset], size);
+        if (checksum) {
+            char crc[CHECKSUM_SIZE];
+            ByteOrder::store<Endian::Big>(crc, Crc32c::compute(out.data() + offset + HEADER_SIZE, size));
+            out.append(crc, CHECKSUM_SIZE);
+        }
+        return (true);
+    }
+};
+
+/**
+ * @brief Stateful frame parser, optionally verifying checksums
+ * The checksum is updated with the payload bytes received since the previous
+ * call, so each byte is checksummed once while the frame streams in. The
+ * buffer must keep earlier bytes unchanged between calls.
+ */
+class FrameReader
+{
+private:
+    bool _checksum;
+    std::size_t _checked{ 0 };
+    Crc32c _crc;
+
+public:
+    /**
+     * @brief Construct a frame parser
+     * @param checksum expect and verify a CRC32C trailer on each frame
+     */
+    FrameReader(bool checksum = false)
+        : _checksum{ checksum }
+    {
+    }
+
+    /**
+     * @brief Parse one frame from the front of a buffer
+     * @param data buffer holding received data
+     * @param len number of bytes in the buffer
+     * @param payload set to a view of the frame payload when complete
+     * @param consumed set to the size of the frame in the buffer when complete
+     * @return Invalid on oversized frames and checksum mismatches
+     */
+    Frame::Status parse(const char *data, std::size_t len, std::string_view &payload, std::size_t &consumed)
+    {
+        if (!_checksum)
+            return (Frame::parse(data, len, payload, consumed));
+        if (len < Frame::HEADER_SIZE)
+            return (Frame::Incomplete);
+        uint32_t size = ByteOrder::load<Endian::Big, uint32_t>(data);
+        if (size > Frame::MAX_SIZE)
+            return (this->fail());
+        std::size_t avail = std::min<std::size_t>(len - Frame::HEADER_SIZE, size);
+        _crc.update(data + Frame::HEADER_SIZE + _checked, avail - _checked);
+        _checked = avail;
+        if (len < Frame::HEADER_SIZE + size + Frame::CHECKSUM_SIZE)
+            return (Frame::Incomplete);
+        uint32_t expected = ByteOrder::load<Endian::Big, uint32_t>(data + Frame::HEADER_SIZE + size);
+        if (_crc.value() != expected)
+            return (this->fail());
+        payload = std::string_view(data + Frame::HEADER_SIZE, size);
+        consumed = Frame::HEADER_SIZE + size + Frame::CHECKSUM_SIZE;
+        this->reset();
+        return (Frame::Complete);
+    }
+
+    /**
+     * @brief Forget any partially received frame
+     */
+    void reset()
+    {
+        _checked = 0;
+        _crc.reset();
+    }
+
+    /**
+     * @brief Check whether frames carry a checksum
+     */
+    inline bool checksum() const
+    {
+        return (_checksum);
+    }
+
+private:
+    Frame::Status fail()
+    {
+        this->reset();
+        return (Frame::Invalid);
+    }
+};
@@ -0,0 +1,240 @@
+/*
+* LibSocket C++ binding
+* Header-only Happy Eyeballs (RFC 8305) connection racing
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "EventLoop.hpp"
+#include "Socket.hpp"
+
+/**
+ * @brief Races connections to the addresses of a host, RFC 8305 style
+ * Addresses are tried in turn, alternating families, each attempt starting
+ * once the previous one failed or after the connection attempt delay, while
+ * earlier attempts keep running. The first connection established wins and
+ * the others are cancelled, so an unreachable address costs at most one delay
+ * instead of a full connect timeout. Without a timer descriptor, attempts
+ * only proceed on failure.
+ */
+class HappyEyeballs
+{
+public:
+    /**
+     * @brief Candidate addresses, e.g. as produced by Resolver; ports are ignored
+     */
+    using Addresses = std::vector<struct sockaddr_storage>;
+    /**
+     * @brief Completion callback, 'error' is 0 on success, else the errno of the last failure
+     * The socket is connected and in blocking mode, or closed on failure.
+     */
+    using Callback = std::function<void(int error, Socket &&sock)>;
+
+    /**
+     * @brief Default delay before starting the next attempt (RFC 8305 section 5)
+     */
+    static constexpr std::chrono::milliseconds ATTEMPT_DELAY{ 250 };
+
+private:
+    EventLoop &_loop;
+    int _tfd{ -1 };
+    Addresses _addrs;
+    std::size_t _next{ 0 };
+    uint16_t _port{ 0 };
+    std::chrono::milliseconds _delay{ ATTEMPT_DELAY };
+    Callback _cb;
+    std::unordered_map<int, Socket> _attempts;
+    int _error{ 0 };
+
+public:
+    /**
+     * @brief Construct a connector
+     * @param loop event loop driving the attempts
+     */
+    HappyEyeballs(EventLoop &loop)
+        : _loop{ loop }, _tfd{ timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC) }
+    {
+        if (_tfd != -1 && !_loop.add(_tfd, EPOLLIN, [this](uint32_t) { this->onTimer(); })) {
+            ::close(_tfd);
+            _tfd = -1;
+        }
+    }
+    HappyEyeballs(const HappyEyeballs &) = delete;
+    HappyEyeballs &operator=(const HappyEyeballs &) = delete;
+    ~HappyEyeballs()
+    {
+        this->cancel();
+        if (_tfd != -1) {
+            _loop.remove(_tfd);
+            ::close(_tfd);
+        }
+    }
+
+    /**
+     * @brief Start connecting, cancelling any race in progress
+     * The callback runs from the loop, or from within this call if every
+     * address fails immediately.
+     * @param addrs candidate addresses, in preference order
+     * @param port remote port, in host byte order
+     * @param cb completion callback
+     * @param delay connection attempt delay
+     */
+    void connect(const Addresses &addrs, uint16_t port, Callback cb,
+                 std::chrono::milliseconds delay = ATTEMPT_DELAY)
+    {
+        this->cancel();
+        _addrs = interleave(addrs);
+        _next = 0;
+        _port = port;
+        _delay = delay;
+        _cb = std::move(cb);
+        _error = EHOSTUNREACH;
+        this->attempt();
+    }
+    /**
+     * @brief Abandon the race in progress without invoking the callback
+     */
+    void cancel()
+    {
+        for (auto &it : _attempts)
+            _loop.remove(it.first);
+        _attempts.clear();
+        _cb = nullptr;
+        this->arm(std::chrono::milliseconds(0));
+    }
+    /**
+     * @brief Check whether a race is in progress
+     */
+    inline bool pending() const
+    {
+        return (static_cast<bool>(_cb));
+    }
+
+    /**
+     * @brief Connect to the first reachable address, blocking until done
+     * @param addrs candidate addresses, in preference order
+     * @param port remote port, in host byte order
+     * @param delay connection attempt delay
+     * @return connected socket, closed if every attempt failed
+     */
+    static Socket connect(const Addresses &addrs, uint16_t port,
+                          std::chrono::milliseconds delay = ATTEMPT_DELAY)
+    {
+        EventLoop loop;
+        HappyEyeballs racer(loop);
+        std::unique_ptr<Socket> result;
+
+        racer.connect(addrs, port, [&result](int, Socket &&sock) { result = std::make_unique<Socket>(std::move(sock)); }, delay);
+        while (racer.pending() && loop.runOnce(-1) != -1)
+            ;
+        return (result ? std::move(*result) : Socket(-1));
+    }
+
+    /**
+     * @brief Order addresses by alternating families, keeping the first address's family first
+     * @param addrs addresses in preference order
+     */
+    static Addresses interleave(const Addresses &addrs)
+    {
+        Addresses first;
+        Addresses other;
+        Addresses result;
+
+        if (addrs.empty())
+            return (result);
+        for (const struct sockaddr_storage &ss : addrs)
+            (ss.ss_family == addrs.front().ss_family ? first : other).push_back(ss);
+        for (std::size_t i = 0; i < first.size() || i < other.size(); ++i) {
+            if (i < first.size())
+                result.push_back(first[i]);
+            if (i < other.size())
+                result.push_back(other[i]);
+        }
+        return (result);
+    }
+
+private:
+    /**
+     * @brief Start the next attempt, failing the race once every address is exhausted
+     */
+    void attempt()
+    {
+        while (_next < _addrs.size()) {
+            const struct sockaddr_storage &ss = _addrs[_next++];
+            if (ss.ss_family != AF_INET && ss.ss_family != AF_INET6)
+                continue;
+            Endpoint ep(ss, _port);
+            Socket sock(ep.family(), SOCK_STREAM);
+            sock.setBlocking(false);
+            sock.connect(ep);
+            int fd = sock.fd();
+            if (!sock.good() || !_loop.add(fd, EPOLLOUT, [this, fd](uint32_t) { this->onEvent(fd); })) {
+                _error = sock.errcode();
+                continue;
+            }
+            _attempts.emplace(fd, std::move(sock));
+            this->arm(_next < _addrs.size() ? _delay : std::chrono::milliseconds(0));
+            return;
+        }
+        this->arm(std::chrono::milliseconds(0));
+        if (_attempts.empty() && _cb) {
+            Callback cb = std::move(_cb);
+            _cb = nullptr;
+            cb(_error, Socket(-1));
+        }
+    }
+
+    void onEvent(int fd)
+    {
+        auto it = _attempts.find(fd);
+        if (it == _attempts.end())
+            return;
+        if (it->second.pendingError() != 0) {
+            _error = it->second.errcode();
+            _loop.remove(fd);
+            _attempts.erase(it);
+            this->attempt();
+            return;
+        }
+        Socket sock = std::move(it->second);
+        _loop.remove(fd);
+        _attempts.erase(it);
+        Callback cb = std::move(_cb);
+        this->cancel();
+        sock.setBlocking(true);
+        cb(0, std::move(sock));
+    }
+
+    void onTimer()
+    {
+        uint64_t expirations = 0;
+
+        if (::read(_tfd, &expirations, sizeof(expirations)) > 0 && _cb)
+            this->attempt();
+    }
+
+    /**
+     * @brief Arm the attempt delay timer, or disarm it with a zero delay
+     */
+    void arm(std::chrono::milliseconds delay)
+    {
+        struct itimerspec spec = {};
+        spec.it_value.tv_sec = delay.count() / 1000;
+        spec.it_value.tv_nsec = (delay.count() % 1000) * 1000000;
+
+        if (_tfd != -1)
+            timerfd_settime(_tfd, 0, &spec, nullptr);
+    }
+};
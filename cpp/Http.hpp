@@ -0,0 +1,612 @@
+/*
+* LibSocket C++ binding
+* Header-only HTTP/1.1 request parser and keep-alive server
+*/
+
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "ConnectionHost.hpp"
+#include "EventLoop.hpp"
+#include "Socket.hpp"
+
+/**
+ * @brief HTTP header, views into the parsed buffer
+ */
+struct HttpHeader
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * @brief Parsed HTTP request
+ * All views point into the parsed buffer and remain valid until the request
+ * bytes are consumed from it.
+ */
+struct HttpRequest
+{
+    /**
+     * @brief Maximum number of headers per request
+     */
+    static constexpr std::size_t MAX_HEADERS = 64;
+
+    std::string_view method;
+    std::string_view target;
+    int minorVersion{ 1 };
+    HttpHeader headers[MAX_HEADERS];
+    std::size_t headerCount{ 0 };
+    std::string_view body;
+    bool keepAlive{ true };
+    bool chunked{ false };
+
+    /**
+     * @brief Find a header value by case-insensitive name
+     * @param name header name
+     * @return header value, or an empty view if the header is missing
+     */
+    std::string_view header(std::string_view name) const
+    {
+        for (std::size_t i = 0; i < headerCount; ++i)
+            if (iequals(headers[i].name, name))
+                return (headers[i].value);
+        return (std::string_view());
+    }
+
+    /**
+     * @brief Compare two ASCII strings case-insensitively
+     */
+    static bool iequals(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+            return (false);
+        for (std::size_t i = 0; i < a.size(); ++i)
+            if ((a[i] | 0x20) != (b[i] | 0x20))
+                return (false);
+        return (true);
+    }
+};
+
+/**
+ * @brief Incremental zero-copy HTTP/1.1 request parser
+ * Feed it the whole unconsumed input every time more data arrives: the end of
+ * headers search resumes where it stopped and chunked bodies are decoded in
+ * place, so the input must stay unchanged between calls apart from appended
+ * data (moving it as a whole, as Socket::fill() does, is fine).
+ */
+class HttpParser
+{
+public:
+    /**
+     * @brief Result of a parse call
+     */
+    enum Status { Complete, Incomplete, Invalid };
+
+    /**
+     * @brief Maximum size of the request line and headers
+     */
+    static constexpr std::size_t MAX_HEADER_SIZE = 16384;
+    /**
+     * @brief Maximum size of a request body
+     */
+    static constexpr std::size_t MAX_BODY_SIZE = 8 << 20;
+
+private:
+    enum ChunkState { ChunkSize, ChunkData, ChunkDataEnd, ChunkTrailer };
+
+    std::size_t _scanned{ 0 };
+    std::size_t _headerLen{ 0 };
+    ChunkState _chunkState{ ChunkSize };
+    std::size_t _chunkSrc{ 0 };
+    std::size_t _chunkDst{ 0 };
+    std::size_t _chunkLeft{ 0 };
+
+public:
+    /**
+     * @brief Parse one request from the front of a buffer
+     * @param data buffer holding received data, chunked bodies are decoded in place
+     * @param len number of bytes in the buffer
+     * @param req request to fill
+     * @param consumed set to the size of the request in the buffer when complete
+     */
+    Status parse(char *data, std::size_t len, HttpRequest &req, std::size_t &consumed)
+    {
+        std::size_t skip = 0;
+        while (skip < len && (data[skip] == '\r' || data[skip] == '\n'))
+            ++skip;
+        if (_headerLen == 0) {
+            Status status = this->findHeaderEnd(data + skip, len - skip);
+            if (status != Complete)
+                return (status);
+        }
+        if (!this->parseHeaders(data + skip, req))
+            return (this->fail());
+
+        const char *base = data + skip + _headerLen;
+        std::size_t avail = len - skip - _headerLen;
+        std::size_t bodyLen = 0;
+        if (req.chunked) {
+            Status status = this->decodeChunked(data + skip + _headerLen, avail);
+            if (status != Complete)
+                return (status == Invalid ? this->fail() : status);
+            req.body = std::string_view(base, _chunkDst);
+            bodyLen = _chunkSrc;
+        } else {
+            std::string_view cl = req.header("Content-Length");
+            if (!cl.empty()) {
+                auto res = std::from_chars(cl.data(), cl.data() + cl.size(), bodyLen);
+                if (res.ec != std::errc() || res.ptr != cl.data() + cl.size() || bodyLen > MAX_BODY_SIZE)
+                    return (this->fail());
+            }
+            if (avail < bodyLen)
+                return (Incomplete);
+            req.body = std::string_view(base, bodyLen);
+        }
+        consumed = skip + _headerLen + bodyLen;
+        this->reset();
+        return (Complete);
+    }
+
+    /**
+     * @brief Forget any partially parsed request
+     */
+    void reset()
+    {
+        _scanned = 0;
+        _headerLen = 0;
+        _chunkState = ChunkSize;
+        _chunkSrc = 0;
+        _chunkDst = 0;
+        _chunkLeft = 0;
+    }
+
+    /**
+     * @brief Find the first occurrence of either of two bytes
+     * Scans 16 bytes at a time when SSE2 is available.
+     * @return pointer to the matching byte, or end if there is none
+     */
+    static const char *findByte(const char *p, const char *end, char a, char b)
+    {
+#if defined(__SSE2__)
+        const __m128i va = _mm_set1_epi8(a);
+        const __m128i vb = _mm_set1_epi8(b);
+        for (; end - p >= 16; p += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+            if (mask != 0)
+                return (p + __builtin_ctz(mask));
+        }
+#endif
+        for (; p < end; ++p)
+            if (*p == a || *p == b)
+                return (p);
+        return (end);
+    }
+
+private:
+    Status fail()
+    {
+        this->reset();
+        return (Invalid);
+    }
+
+    /**
+     * @brief Look for the empty line ending the headers, resuming the previous scan
+     */
+    Status findHeaderEnd(const char *data, std::size_t len)
+    {
+        const char *end = data + len;
+        const char *p = data + (_scanned > 3 ? _scanned - 3 : 0);
+
+        while ((p = findByte(p, end, '\n', '\n')) != end) {
+            if (p + 1 < end && p[1] == '\n') {
+                _headerLen = p + 2 - data;
+                return (Complete);
+            }
+            if (p + 2 < end && p[1] == '\r' && p[2] == '\n') {
+                _headerLen = p + 3 - data;
+                return (Complete);
+            }
+            ++p;
+        }
+        _scanned = len;
+        return (len > MAX_HEADER_SIZE ? this->fail() : Incomplete);
+    }
+
+    /**
+     * @brief Tokenize request line and headers, which end at _headerLen
+     */
+    bool parseHeaders(const char *data, HttpRequest &req)
+    {
+        const char *end = data + _headerLen;
+        const char *p = findByte(data, end, ' ', '\n');
+        if (p == end || *p != ' ' || p == data)
+            return (false);
+        req.method = std::string_view(data, p - data);
+        const char *target = p + 1;
+        p = findByte(target, end, ' ', '\n');
+        if (p == end || *p != ' ' || p == target)
+            return (false);
+        req.target = std::string_view(target, p - target);
+        const char *version = p + 1;
+        p = findByte(version, end, '\n', '\n');
+        std::string_view vstr = trimRight(std::string_view(version, p - version));
+        if (vstr.size() != 8 || vstr.substr(0, 7) != "HTTP/1." || vstr[7] < '0' || vstr[7] > '9')
+            return (false);
+        req.minorVersion = vstr[7] - '0';
+        req.headerCount = 0;
+        req.keepAlive = (req.minorVersion >= 1);
+        req.chunked = false;
+
+        for (++p; p < end && *p != '\r' && *p != '\n'; ++p) {
+            if (req.headerCount == HttpRequest::MAX_HEADERS || *p == ' ' || *p == '\t')
+                return (false);
+            const char *colon = findByte(p, end, ':', '\n');
+            if (colon == end || *colon != ':' || colon == p)
+                return (false);
+            const char *value = colon + 1;
+            while (value < end && (*value == ' ' || *value == '\t'))
+                ++value;
+            const char *eol = findByte(value, end, '\n', '\n');
+            HttpHeader &h = req.headers[req.headerCount++];
+            h.name = std::string_view(p, colon - p);
+            h.value = trimRight(std::string_view(value, eol - value));
+            p = eol;
+        }
+        return (this->applyHeaders(req));
+    }
+
+    /**
+     * @brief Derive connection persistence and framing from parsed headers
+     */
+    static bool applyHeaders(HttpRequest &req)
+    {
+        std::string_view conn = req.header("Connection");
+        if (HttpRequest::iequals(conn, "close"))
+            req.keepAlive = false;
+        else if (HttpRequest::iequals(conn, "keep-alive"))
+            req.keepAlive = true;
+        std::string_view te = req.header("Transfer-Encoding");
+        if (!te.empty()) {
+            if (te.size() < 7 || !HttpRequest::iequals(te.substr(te.size() - 7), "chunked"))
+                return (false);
+            if (!req.header("Content-Length").empty())
+                return (false);
+            req.chunked = true;
+        }
+        // differing lengths let a proxy and this server split requests differently
+        std::string_view length;
+        for (std::size_t i = 0; i < req.headerCount; ++i) {
+            if (!HttpRequest::iequals(req.headers[i].name, "Content-Length"))
+                continue;
+            if (!length.empty() && req.headers[i].value != length)
+                return (false);
+            length = req.headers[i].value;
+        }
+        return (true);
+    }
+
+    /**
+     * @brief Decode a chunked body in place, resuming the previous call
+     * @param base start of the body in the buffer
+     * @param len number of bytes available after the headers
+     */
+    Status decodeChunked(char *base, std::size_t len)
+    {
+        while (true) {
+            const char *src = base + _chunkSrc;
+            const char *end = base + len;
+            if (_chunkState == ChunkData) {
+                std::size_t n = std::min(_chunkLeft, len - _chunkSrc);
+                std::memmove(base + _chunkDst, src, n);
+                _chunkDst += n;
+                _chunkSrc += n;
+                _chunkLeft -= n;
+                if (_chunkLeft > 0)
+                    return (Incomplete);
+                _chunkState = ChunkDataEnd;
+                continue;
+            }
+            if (_chunkState == ChunkDataEnd) {
+                if (src < end && *src == '\r')
+                    ++src;
+                if (src >= end)
+                    return (Incomplete);
+                if (*src != '\n')
+                    return (Invalid);
+                _chunkSrc = src + 1 - base;
+                _chunkState = ChunkSize;
+                continue;
+            }
+            const char *eol = findByte(src, end, '\n', '\n');
+            if (eol == end)
+                return (len - _chunkSrc > MAX_HEADER_SIZE ? Invalid : Incomplete);
+            std::string_view line = trimRight(std::string_view(src, eol - src));
+            _chunkSrc = eol + 1 - base;
+            if (_chunkState == ChunkTrailer) {
+                if (line.empty())
+                    return (Complete);
+                continue;
+            }
+            std::size_t size = 0;
+            auto res = std::from_chars(line.data(), line.data() + line.size(), size, 16);
+            if (res.ec != std::errc() || res.ptr == line.data()
+                || (res.ptr != line.data() + line.size() && *res.ptr != ';'))
+                return (Invalid);
+            if (size > MAX_BODY_SIZE - _chunkDst)
+                return (Invalid);
+            _chunkLeft = size;
+            _chunkState = (size == 0) ? ChunkTrailer : ChunkData;
+        }
+    }
+
+    static std::string_view trimRight(std::string_view str)
+    {
+        while (!str.empty() && (str.back() == '\r' || str.back() == ' ' || str.back() == '\t'))
+            str.remove_suffix(1);
+        return (str);
+    }
+};
+
+/**
+ * @brief HTTP response writer, serializes straight into a connection's output
+ * Calls must follow the status, header, body order; a missing status line
+ * defaults to "200 OK".
+ */
+class HttpResponse
+{
+private:
+    std::string &_out;
+    bool _keepAlive;
+    int _minorVersion;
+    bool _started{ false };
+    bool _done{ false };
+
+public:
+    /**
+     * @brief Construct a response appending to an output buffer
+     * @param out connection output buffer
+     * @param keepAlive whether the connection stays open after the response
+     * @param minorVersion HTTP/1.x version of the request, HTTP/1.0 clients
+     * only keep the connection open when told so
+     */
+    HttpResponse(std::string &out, bool keepAlive, int minorVersion = 1)
+        : _out{ out }, _keepAlive{ keepAlive }, _minorVersion{ minorVersion }
+    {
+    }
+
+    /**
+     * @brief Write the status line
+     * @param code HTTP status code
+     * @param reason reason phrase
+     */
+    HttpResponse &status(int code, std::string_view reason = "OK")
+    {
+        char num[16];
+        auto res = std::to_chars(num, num + sizeof(num), code);
+
+        _started = true;
+        _out.append("HTTP/1.1 ");
+        _out.append(num, res.ptr - num);
+        _out.push_back(' ');
+        _out.append(reason);
+        _out.append("\r\n");
+        return (*this);
+    }
+    /**
+     * @brief Write a header
+     * @param name header name
+     * @param value header value
+     */
+    HttpResponse &header(std::string_view name, std::string_view value)
+    {
+        if (!_started)
+            this->status(200);
+        _out.append(name);
+        _out.append(": ");
+        _out.append(value);
+        _out.append("\r\n");
+        return (*this);
+    }
+    /**
+     * @brief Write the body and complete the response
+     * @param data response body
+     */
+    void body(std::string_view data)
+    {
+        char num[24];
+        auto res = std::to_chars(num, num + sizeof(num), data.size());
+
+        if (_done)
+            return;
+        if (!_started)
+            this->status(200);
+        if (!_keepAlive)
+            _out.append("Connection: close\r\n");
+        else if (_minorVersion == 0)
+            _out.append("Connection: keep-alive\r\n");
+        _out.append("Content-Length: ");
+        _out.append(num, res.ptr - num);
+        _out.append("\r\n\r\n");
+        _out.append(data);
+        _done = true;
+    }
+    /**
+     * @brief Complete the response with an empty body if not done yet
+     */
+    void finish()
+    {
+        this->body(std::string_view());
+    }
+
+    /**
+     * @brief Close the connection after this response, must precede body()
+     */
+    void close()
+    {
+        _keepAlive = false;
+    }
+    /**
+     * @brief Check whether the connection stays open after this response
+     */
+    inline bool keepAlive() const
+    {
+        return (_keepAlive);
+    }
+};
+
+/**
+ * @brief Minimal keep-alive HTTP/1.1 server running on an EventLoop
+ * Pipelined requests received together are answered with a single write.
+ */
+class HttpServer
+{
+public:
+    /**
+     * @brief Request handler
+     */
+    using Handler = std::function<void(const HttpRequest &, HttpResponse &)>;
+
+private:
+    struct Connection
+    {
+        Socket sock;
+        HttpParser parser;
+        std::string out;
+        std::size_t outpos{ 0 };
+        bool closing{ false };
+        bool writing{ false };
+        uint64_t requests{ 0 };
+
+        Connection(Socket &&s)
+            : sock{ std::move(s) }
+        {
+        }
+    };
+
+    EventLoop &_loop;
+    Handler _handler;
+    Socket _listener;
+    ConnectionHost<Connection> _conns;
+
+public:
+    /**
+     * @brief Construct a new server
+     * @param loop event loop driving the server
+     * @param handler request handler
+     */
+    HttpServer(EventLoop &loop, Handler handler)
+        : _loop{ loop }, _handler{ std::move(handler) }, _conns{ loop, [this](Connection &conn) { this->process(conn); } }
+    {
+    }
+    HttpServer(const HttpServer &) = delete;
+    HttpServer &operator=(const HttpServer &) = delete;
+    ~HttpServer()
+    {
+        if (_listener.isOpen())
+            _loop.remove(_listener.fd());
+    }
+
+    /**
+     * @brief Listen to connections on given endpoint
+     * @param ep endpoint to listen to
+     * @param count amount of connections to listen to
+     */
+    bool listen(const Endpoint &ep, int count = SOMAXCONN)
+    {
+        _listener.listen(ep, count);
+        _listener.setBlocking(false);
+        return (_listener.good() && _loop.add(_listener.fd(), EPOLLIN, [this](uint32_t) { this->onAccept(); }));
+    }
+    /**
+     * @brief Listen to connections on given port and address
+     * @param port port to listen to, in network byte order
+     * @param addr address to listen to, in network byte order
+     * @param count amount of connections to listen to
+     */
+    bool listen(in_port_t port, in_addr_t addr, int count = SOMAXCONN)
+    {
+        return (this->listen(Endpoint::ipv4(ntohl(addr), ntohs(port)), count));
+    }
+
+    /**
+     * @brief Get the listening socket
+     */
+    inline Socket &socket()
+    {
+        return (_listener);
+    }
+
+    /**
+     * @brief Get the descriptors of the open connections
+     * Like every member below, call from the loop's thread.
+     */
+    std::vector<int> connections() const
+    {
+        return (_conns.connections());
+    }
+    /**
+     * @brief Get the number of requests a connection made so far, 0 if unknown
+     */
+    uint64_t requests(int fd) const
+    {
+        return (_conns.requests(fd));
+    }
+    /**
+     * @brief Move a live connection to a server running on another loop
+     * Buffered input, parser state and pending output move along, and the
+     * connection stays open. Call outside the server's callbacks, from a
+     * posted task for instance; 'target' adopts it on its own loop's thread.
+     * @return false if 'fd' is not a connection of this server
+     */
+    bool migrate(int fd, HttpServer &target)
+    {
+        return (_conns.migrate(fd, target._conns));
+    }
+
+private:
+    void onAccept()
+    {
+        while (true) {
+            Socket client = _listener.accept();
+            if (!client.isOpen())
+                return;
+            client.setBlocking(false);
+            _conns.adopt(std::make_shared<Connection>(std::move(client)));
+        }
+    }
+
+    void process(Connection &conn)
+    {
+        HttpRequest req;
+        std::size_t consumed = 0;
+
+        while (!conn.closing) {
+            HttpParser::Status status = conn.parser.parse(conn.sock.bufferedData(), conn.sock.bufferedSize(), req, consumed);
+            if (status == HttpParser::Incomplete)
+                return;
+            if (status == HttpParser::Invalid) {
+                HttpResponse res(conn.out, false);
+                res.status(400, "Bad Request").finish();
+                conn.closing = true;
+                return;
+            }
+            HttpResponse res(conn.out, req.keepAlive, req.minorVersion);
+            ++conn.requests;
+            _handler(req, res);
+            res.finish();
+            conn.closing = !res.keepAlive();
+            conn.sock.consume(consumed);
+        }
+    }
+};
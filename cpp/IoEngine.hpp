@@ -0,0 +1,1102 @@
+/*
+* LibSocket C++ binding
+* Header-only completion-based I/O engines over epoll and io_uring
+*
+* Define LIBSOCKET_USE_IO_URING to make IoEngine the io_uring backend.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "Endpoint.hpp"
+
+/**
+ * @brief Result of a finished operation
+ */
+struct IoCompletion
+{
+    /**
+     * @brief Value given when submitting the operation
+     */
+    uint64_t user;
+    /**
+     * @brief Bytes transferred, accepted descriptor or 0 on success, -errno on failure
+     */
+    int result;
+    uint32_t flags;
+};
+
+/**
+ * @brief Completion engine emulated over epoll(7)
+ * Operations are attempted right away and, if they would block, queued per
+ * descriptor and direction until epoll reports readiness, so operations on
+ * one descriptor complete in submission order (UringEngine does not promise
+ * this: portable code keeps one read and one write pending per descriptor,
+ * or tolerates reordering). Descriptors are switched to
+ * non-blocking mode on first use and must be closed through close() so their
+ * state is released.
+ *
+ * EpollEngine and UringEngine expose the same members; code written against
+ * either one (or a template parameter) works with the other, without virtual
+ * dispatch.
+ */
+class EpollEngine
+{
+public:
+    /**
+     * @brief Maximum number of epoll events handled per wait
+     */
+    static constexpr int MAX_EVENTS = 256;
+
+private:
+    struct Op
+    {
+        enum Type : uint8_t { Read, Write, Accept, Connect };
+
+        Type type;
+        bool started;
+        char *buf;
+        std::size_t len;
+        const Endpoint *ep;
+        uint64_t user;
+        // assigned by the engine, names the operation as a link predecessor
+        uint64_t seq;
+    };
+
+    /**
+     * @brief Operation linked to one still in flight, started once that one succeeds
+     */
+    struct Held
+    {
+        int fd;
+        Op op;
+        // link timeout in milliseconds, armed when the operation starts, -1 for none
+        int timeout;
+    };
+
+    struct FdState
+    {
+        std::deque<Op> in;
+        std::deque<Op> out;
+    };
+
+    int _epfd{ -1 };
+    int _errno{ 0 };
+    std::unordered_map<int, FdState> _fds;
+    std::vector<IoCompletion> _ready;
+    std::size_t _readypos{ 0 };
+    struct Deadline
+    {
+        std::chrono::steady_clock::time_point at;
+        int fd;
+        uint64_t seq;
+
+        bool operator<(const Deadline &other) const
+        {
+            return (at > other.at);
+        }
+    };
+    std::vector<Deadline> _deadlines;
+    // held operations, by the seq of the operation they are linked to
+    std::unordered_map<uint64_t, Held> _held;
+    uint64_t _seq{ 0 };
+    // last submitted operation, for link() and linkTimeout()
+    uint64_t _lastSeq{ 0 };
+    int _lastFd{ -1 };
+    bool _lastPending{ false };
+    bool _lastBroken{ false };
+    // seq of the operation the last one is held behind, 0 if not held
+    uint64_t _lastHeldBy{ 0 };
+    bool _linked{ false };
+
+public:
+    /**
+     * @brief Construct an engine
+     * @param entries unused, for interface compatibility with UringEngine
+     */
+    EpollEngine(unsigned entries = 256)
+        : _epfd{ epoll_create1(EPOLL_CLOEXEC) }
+    {
+        (void)entries;
+        _errno = errno;
+    }
+    EpollEngine(const EpollEngine &) = delete;
+    EpollEngine &operator=(const EpollEngine &) = delete;
+    ~EpollEngine()
+    {
+        if (_epfd != -1)
+            ::close(_epfd);
+    }
+
+    /**
+     * @brief Check if the engine was successfully created
+     */
+    inline bool good() const
+    {
+        return (_epfd != -1);
+    }
+    /**
+     * @brief Get last error code
+     */
+    inline int errcode() const
+    {
+        return (_errno);
+    }
+    /**
+     * @brief Name of the backend
+     */
+    static constexpr const char *name()
+    {
+        return ("epoll");
+    }
+
+    /**
+     * @brief Receive up to 'len' bytes into 'buf'
+     */
+    bool read(int fd, char *buf, std::size_t len, uint64_t user)
+    {
+        return (this->queue(fd, Op{ Op::Read, false, buf, len, nullptr, user, 0 }));
+    }
+    /**
+     * @brief Send up to 'len' bytes from 'buf'
+     */
+    bool write(int fd, const char *buf, std::size_t len, uint64_t user)
+    {
+        return (this->queue(fd, Op{ Op::Write, false, const_cast<char *>(buf), len, nullptr, user, 0 }));
+    }
+    /**
+     * @brief Accept a connection on a listening socket, the result is the new descriptor
+     */
+    bool accept(int fd, uint64_t user)
+    {
+        return (this->queue(fd, Op{ Op::Accept, false, nullptr, 0, nullptr, user, 0 }));
+    }
+    /**
+     * @brief Connect a socket, 'ep' must stay valid until completion
+     */
+    bool connect(int fd, const Endpoint &ep, uint64_t user)
+    {
+        return (this->queue(fd, Op{ Op::Connect, false, nullptr, 0, &ep, user, 0 }));
+    }
+    /**
+     * @brief Close a descriptor, cancelling its pending operations with -ECANCELED
+     */
+    bool close(int fd, uint64_t user)
+    {
+        FdState cancelled;
+        auto it = _fds.find(fd);
+        if (it != _fds.end()) {
+            cancelled = std::move(it->second);
+            epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, nullptr);
+            _fds.erase(it);
+        }
+        this->complete(user, ::close(fd) == -1 ? -errno : 0);
+        // after the descriptor is gone, so that operations linked to these fail
+        for (const Op &op : cancelled.in)
+            this->finish(op, -ECANCELED);
+        for (const Op &op : cancelled.out)
+            this->finish(op, -ECANCELED);
+        return (true);
+    }
+
+    /**
+     * @brief Descriptor marked hot, see hot()
+     */
+    struct Hot
+    {
+        int fd;
+        int slot;
+    };
+    /**
+     * @brief Registered descriptors do not exist for this backend, always succeeds
+     */
+    inline bool registerFiles(unsigned slots)
+    {
+        (void)slots;
+        return (true);
+    }
+    /**
+     * @brief Registered buffers do not exist for this backend, always succeeds
+     */
+    inline bool registerBuffers(const struct iovec *iov, unsigned count)
+    {
+        (void)iov;
+        (void)count;
+        return (true);
+    }
+    /**
+     * @brief Mark a descriptor as hot, a plain descriptor for this backend
+     */
+    inline Hot hot(int fd)
+    {
+        return (Hot{ fd, -1 });
+    }
+    inline void cool(Hot &h)
+    {
+        (void)h;
+    }
+    inline bool read(const Hot &h, char *buf, std::size_t len, uint64_t user, int buffer = -1)
+    {
+        (void)buffer;
+        return (this->read(h.fd, buf, len, user));
+    }
+    inline bool write(const Hot &h, const char *buf, std::size_t len, uint64_t user, int buffer = -1)
+    {
+        (void)buffer;
+        return (this->write(h.fd, buf, len, user));
+    }
+
+    /**
+     * @brief Make the next operation depend on the last one
+     * As with io_uring, the next operation is not attempted before the last
+     * one completes, and is cancelled with -ECANCELED if that one fails;
+     * cancellation runs down a chain. A short transfer does not break it,
+     * as for recv and send entries without MSG_WAITALL.
+     */
+    inline bool link()
+    {
+        _linked = true;
+        return (true);
+    }
+    /**
+     * @brief Cancel the last operation with -ECANCELED if still pending after 'ms' milliseconds
+     * For an operation held by a link, the time counts from when it starts.
+     */
+    bool linkTimeout(int ms)
+    {
+        auto held = _held.find(_lastHeldBy);
+        if (held != _held.end())
+            held->second.timeout = ms;
+        else if (_lastPending)
+            this->deadline(_lastFd, _lastSeq, ms);
+        return (true);
+    }
+
+    /**
+     * @brief Start queued operations, nothing to do for this backend
+     * @return 0
+     */
+    inline int submit()
+    {
+        return (0);
+    }
+    /**
+     * @brief Wait for completions
+     * @param out array receiving completions
+     * @param max size of the array
+     * @param timeout maximum wait in milliseconds, -1 to wait indefinitely
+     * @return number of completions, -1 on error
+     */
+    int wait(IoCompletion *out, int max, int timeout)
+    {
+        auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        while (_readypos == _ready.size()) {
+            int wait = timeout < 0 ? -1 : remaining(until);
+            if (!_deadlines.empty()) {
+                int left = remaining(_deadlines.front().at);
+                wait = wait < 0 ? left : std::min(wait, left);
+            }
+            struct epoll_event events[MAX_EVENTS];
+            int count = epoll_wait(_epfd, events, MAX_EVENTS, wait);
+            if (count == -1) {
+                _errno = errno;
+                return (_errno == EINTR ? 0 : -1);
+            }
+            for (int i = 0; i < count; ++i)
+                this->onEvent(events[i].data.fd);
+            this->expire();
+            if (timeout >= 0 && std::chrono::steady_clock::now() >= until)
+                break;
+        }
+        int n = 0;
+        while (n < max && _readypos < _ready.size())
+            out[n++] = _ready[_readypos++];
+        if (_readypos == _ready.size()) {
+            _ready.clear();
+            _readypos = 0;
+        }
+        return (n);
+    }
+
+private:
+    void complete(uint64_t user, int result)
+    {
+        _ready.push_back(IoCompletion{ user, result, 0 });
+    }
+
+    /**
+     * @brief Milliseconds left until a point in time, rounded up, 0 if past
+     */
+    static int remaining(std::chrono::steady_clock::time_point at)
+    {
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(at - std::chrono::steady_clock::now());
+        return (static_cast<int>(std::max<long>(0, left.count())));
+    }
+
+    void deadline(int fd, uint64_t seq, int ms)
+    {
+        _deadlines.push_back(Deadline{ std::chrono::steady_clock::now() + std::chrono::milliseconds(ms), fd, seq });
+        std::push_heap(_deadlines.begin(), _deadlines.end());
+    }
+
+    /**
+     * @brief Report a finished operation, then start or cancel the one linked to it
+     */
+    void finish(const Op &op, int result)
+    {
+        bool broken = result < 0;
+
+        this->complete(op.user, result);
+        if (op.seq == _lastSeq) {
+            _lastPending = false;
+            _lastBroken = broken;
+        }
+        auto it = _held.find(op.seq);
+        if (it == _held.end())
+            return;
+        Held next = it->second;
+        _held.erase(it);
+        if (next.op.seq == _lastSeq)
+            _lastHeldBy = 0;
+        if (broken)
+            this->finish(next.op, -ECANCELED);
+        else
+            this->start(next.fd, next.op, next.timeout);
+    }
+
+    /**
+     * @brief Cancel operations whose timeout passed, ignoring completed ones
+     */
+    void expire()
+    {
+        auto now = std::chrono::steady_clock::now();
+        while (!_deadlines.empty() && _deadlines.front().at <= now) {
+            Deadline d = _deadlines.front();
+            std::pop_heap(_deadlines.begin(), _deadlines.end());
+            _deadlines.pop_back();
+            auto it = _fds.find(d.fd);
+            if (it == _fds.end())
+                continue;
+            for (std::deque<Op> *ops : { &it->second.in, &it->second.out }) {
+                auto op = std::find_if(ops->begin(), ops->end(), [&](const Op &o) { return (o.seq == d.seq); });
+                if (op != ops->end()) {
+                    Op cancelled = *op;
+                    ops->erase(op);
+                    this->finish(cancelled, -ECANCELED);
+                }
+            }
+        }
+    }
+
+    bool queue(int fd, Op op)
+    {
+        uint64_t pred = _lastSeq;
+        bool inFlight = _lastPending || _lastHeldBy != 0;
+        bool broken = _lastBroken;
+        bool linked = std::exchange(_linked, false);
+
+        op.seq = ++_seq;
+        _lastSeq = op.seq;
+        _lastFd = fd;
+        _lastPending = false;
+        _lastBroken = false;
+        _lastHeldBy = 0;
+        if (linked && inFlight) {
+            _held.emplace(pred, Held{ fd, op, -1 });
+            _lastHeldBy = pred;
+            return (true);
+        }
+        if (linked && broken) {
+            this->finish(op, -ECANCELED);
+            return (true);
+        }
+        return (this->start(fd, op, -1));
+    }
+
+    /**
+     * @brief Attempt an operation, queueing it if it would block
+     * @param timeout link timeout armed if it is queued, -1 for none
+     */
+    bool start(int fd, const Op &op, int timeout)
+    {
+        auto it = _fds.find(fd);
+        if (it == _fds.end()) {
+            int flags = fcntl(fd, F_GETFL, 0);
+            if (flags != -1 && (flags & O_NONBLOCK) == 0)
+                fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+            it = _fds.emplace(fd, FdState()).first;
+        }
+        FdState &state = it->second;
+        bool input = op.type == Op::Read || op.type == Op::Accept;
+        std::deque<Op> &ops = input ? state.in : state.out;
+        int result = 0;
+        Op attempted = op;
+        if (ops.empty() && this->attempt(fd, attempted, result)) {
+            this->finish(attempted, result);
+            return (true);
+        }
+        if (op.seq == _lastSeq)
+            _lastPending = true;
+        if (timeout >= 0)
+            this->deadline(fd, op.seq, timeout);
+        ops.push_back(attempted);
+        return (this->arm(fd, state));
+    }
+
+    /**
+     * @brief Try an operation
+     * @return false if it would block
+     */
+    static bool attempt(int fd, Op &op, int &result)
+    {
+        ssize_t r = 0;
+
+        switch (op.type) {
+        case Op::Read:
+            r = ::read(fd, op.buf, op.len);
+            break;
+        case Op::Write:
+            r = ::send(fd, op.buf, op.len, MSG_NOSIGNAL);
+            if (r == -1 && errno == ENOTSOCK)
+                r = ::write(fd, op.buf, op.len);
+            break;
+        case Op::Accept:
+            r = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+            break;
+        case Op::Connect:
+            if (op.started) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                result = -err;
+                return (true);
+            }
+            op.started = true;
+            r = ::connect(fd, op.ep->addr(), op.ep->length());
+            if (r == -1 && errno == EINPROGRESS)
+                return (false);
+            break;
+        }
+        if (r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return (false);
+        result = r == -1 ? -errno : static_cast<int>(r);
+        return (true);
+    }
+
+    /**
+     * @brief Watch a descriptor for the directions with pending operations
+     * One-shot, so a descriptor without pending operations never reports
+     * events, not even hang-ups.
+     */
+    bool arm(int fd, FdState &state)
+    {
+        struct epoll_event ev = {};
+        ev.events = EPOLLONESHOT | (state.in.empty() ? 0u : EPOLLIN) | (state.out.empty() ? 0u : EPOLLOUT);
+        ev.data.fd = fd;
+
+        if (epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev) == -1
+            && (errno != ENOENT || epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) == -1)) {
+            _errno = errno;
+            return (false);
+        }
+        return (true);
+    }
+
+    void onEvent(int fd)
+    {
+        auto it = _fds.find(fd);
+        if (it == _fds.end())
+            return;
+        FdState &state = it->second;
+        int result = 0;
+        for (std::deque<Op> *ops : { &state.in, &state.out })
+            while (!ops->empty() && this->attempt(fd, ops->front(), result)) {
+                Op done = ops->front();
+                ops->pop_front();
+                this->finish(done, result);
+            }
+        if (!state.in.empty() || !state.out.empty())
+            this->arm(fd, state);
+    }
+};
+
+/**
+ * @brief Completion engine over io_uring(7), using raw system calls
+ * Operations are queued in the submission ring and handed to the kernel by
+ * submit() or wait(), many per system call. Several reads (or writes) pending
+ * on one descriptor may complete in any order.
+ */
+class UringEngine
+{
+private:
+    int _fd{ -1 };
+    int _errno{ 0 };
+    unsigned _sqEntries{ 0 };
+    unsigned *_sqHead{ nullptr };
+    unsigned *_sqTail{ nullptr };
+    unsigned _sqMask{ 0 };
+    unsigned _localTail{ 0 };
+    unsigned *_cqHead{ nullptr };
+    unsigned *_cqTail{ nullptr };
+    unsigned _cqMask{ 0 };
+    struct io_uring_cqe *_cqes{ nullptr };
+    struct io_uring_sqe *_sqes{ nullptr };
+    void *_sqRing{ MAP_FAILED };
+    void *_cqRing{ MAP_FAILED };
+    std::size_t _sqRingSize{ 0 };
+    std::size_t _cqRingSize{ 0 };
+    uint32_t _features{ 0 };
+    unsigned _files{ 0 };
+    std::vector<int> _freeSlots;
+    unsigned *_sqFlags{ nullptr };
+    bool _sqpoll{ false };
+    // last prepared entry, until handed to the kernel, for link()
+    struct io_uring_sqe *_last{ nullptr };
+    // timeouts of link and wait timeout entries, by submission entry: the
+    // kernel reads them when it consumes the entry
+    std::vector<struct __kernel_timespec> _timeouts;
+
+public:
+    /**
+     * @brief User value of the engine's own entries, never returned by wait()
+     */
+    static constexpr uint64_t INTERNAL = ~uint64_t(0);
+
+    /**
+     * @brief Settings of the kernel submission polling thread (IORING_SETUP_SQPOLL)
+     */
+    struct SqPoll
+    {
+        /**
+         * @brief Milliseconds without submissions before the thread sleeps
+         */
+        unsigned idle;
+        /**
+         * @brief CPU the thread is pinned to, -1 to let the scheduler place it
+         */
+        int cpu;
+    };
+    /**
+     * @brief Submission counters
+     */
+    struct Stats
+    {
+        /**
+         * @brief Calls to submit() or wait() that had new entries to hand over
+         */
+        uint64_t submits;
+        /**
+         * @brief io_uring_enter(2) system calls
+         */
+        uint64_t enters;
+        /**
+         * @brief Submissions that found the polling thread idle and had to wake it
+         */
+        uint64_t wakeups;
+    };
+
+    /**
+     * @brief Descriptor marked hot, see hot()
+     */
+    struct Hot
+    {
+        int fd;
+        /**
+         * @brief Index in the registered table, -1 if not registered
+         */
+        int slot;
+    };
+
+    /**
+     * @brief Construct an engine
+     * @param entries submission ring size, rounded up to a power of two
+     * @param flags IORING_SETUP_* flags
+     */
+    UringEngine(unsigned entries = 256, uint32_t flags = 0)
+    {
+        struct io_uring_params params = {};
+        params.flags = flags;
+        this->setup(entries, params);
+    }
+    /**
+     * @brief Construct an engine whose submissions are consumed by a kernel thread
+     * In steady state submit() only writes to the shared ring, and wait() with
+     * a zero timeout only reads from it: no system call is made until the
+     * thread idles out, after which the next submission wakes it.
+     * @param entries submission ring size, rounded up to a power of two
+     * @param poll polling thread settings
+     */
+    UringEngine(unsigned entries, const SqPoll &poll)
+    {
+        struct io_uring_params params = {};
+        params.flags = IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = poll.idle;
+        if (poll.cpu >= 0) {
+            params.flags |= IORING_SETUP_SQ_AFF;
+            params.sq_thread_cpu = static_cast<uint32_t>(poll.cpu);
+        }
+        this->setup(entries, params);
+    }
+    UringEngine(const UringEngine &) = delete;
+    UringEngine &operator=(const UringEngine &) = delete;
+    ~UringEngine()
+    {
+        if (_sqes != nullptr)
+            munmap(_sqes, _sqEntries * sizeof(struct io_uring_sqe));
+        if (_cqRing != MAP_FAILED && _cqRing != _sqRing)
+            munmap(_cqRing, _cqRingSize);
+        if (_sqRing != MAP_FAILED)
+            munmap(_sqRing, _sqRingSize);
+        if (_fd != -1)
+            ::close(_fd);
+    }
+
+    /**
+     * @brief Check if the engine was successfully created
+     */
+    inline bool good() const
+    {
+        return (_sqes != nullptr);
+    }
+    /**
+     * @brief Get last error code
+     */
+    inline int errcode() const
+    {
+        return (_errno);
+    }
+    /**
+     * @brief Name of the backend
+     */
+    static constexpr const char *name()
+    {
+        return ("io_uring");
+    }
+    /**
+     * @brief Check if submissions are consumed by a kernel polling thread
+     */
+    inline bool polling() const
+    {
+        return (_sqpoll);
+    }
+    /**
+     * @brief Get submission counters
+     */
+    inline const Stats &stats() const
+    {
+        return (_stats);
+    }
+
+    /**
+     * @brief Receive up to 'len' bytes into 'buf'
+     */
+    bool read(int fd, char *buf, std::size_t len, uint64_t user)
+    {
+        struct io_uring_sqe *sqe = this->prepare(IORING_OP_RECV, fd, user);
+        if (sqe == nullptr)
+            return (false);
+        sqe->addr = reinterpret_cast<uint64_t>(buf);
+        sqe->len = static_cast<uint32_t>(len);
+        return (true);
+    }
+    /**
+     * @brief Send up to 'len' bytes from 'buf'
+     */
+    bool write(int fd, const char *buf, std::size_t len, uint64_t user)
+    {
+        struct io_uring_sqe *sqe = this->prepare(IORING_OP_SEND, fd, user);
+        if (sqe == nullptr)
+            return (false);
+        sqe->addr = reinterpret_cast<uint64_t>(buf);
+        sqe->len = static_cast<uint32_t>(len);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        return (true);
+    }
+    /**
+     * @brief Accept a connection on a listening socket, the result is the new descriptor
+     */
+    bool accept(int fd, uint64_t user)
+    {
+        struct io_uring_sqe *sqe = this->prepare(IORING_OP_ACCEPT, fd, user);
+        if (sqe == nullptr)
+            return (false);
+        sqe->accept_flags = SOCK_CLOEXEC;
+        return (true);
+    }
+    /**
+     * @brief Connect a socket, 'ep' must stay valid until completion
+     */
+    bool connect(int fd, const Endpoint &ep, uint64_t user)
+    {
+        struct io_uring_sqe *sqe = this->prepare(IORING_OP_CONNECT, fd, user);
+        if (sqe == nullptr)
+            return (false);
+        sqe->addr = reinterpret_cast<uint64_t>(ep.addr());
+        sqe->off = ep.length();
+        return (true);
+    }
+    /**
+     * @brief Close a descriptor
+     * A descriptor marked hot stays open in the kernel until cool() is called.
+     */
+    bool close(int fd, uint64_t user)
+    {
+        return (this->prepare(IORING_OP_CLOSE, fd, user) != nullptr);
+    }
+
+    /**
+     * @brief Reserve a table of registered descriptors (IORING_REGISTER_FILES)
+     * The kernel resolves registered descriptors by index instead of looking
+     * them up and reference counting them on every operation.
+     * @param slots number of descriptors that can be hot at the same time
+     */
+    bool registerFiles(unsigned slots)
+    {
+        std::vector<int> fds(slots, -1);
+
+        if (!_freeSlots.empty() || _files != 0) {
+            _errno = EBUSY;
+            return (false);
+        }
+        if (this->registerCall(IORING_REGISTER_FILES, fds.data(), slots) == -1)
+            return (false);
+        _files = slots;
+        for (unsigned i = slots; i > 0; --i)
+            _freeSlots.push_back(static_cast<int>(i - 1));
+        return (true);
+    }
+    /**
+     * @brief Register fixed buffers (IORING_REGISTER_BUFFERS)
+     * Their pages are pinned once, instead of on every operation that needs
+     * them pinned. Plain socket reads and writes copy instead of pinning, so on
+     * sockets the gain is small and measure before relying on it. Hot reads
+     * and writes given a buffer index must stay inside that buffer.
+     */
+    bool registerBuffers(const struct iovec *iov, unsigned count)
+    {
+        return (this->registerCall(IORING_REGISTER_BUFFERS, iov, count) != -1);
+    }
+    /**
+     * @brief Mark a descriptor as hot, placing it in the registered table
+     * Falls back to the plain descriptor when no slot is free.
+     */
+    Hot hot(int fd)
+    {
+        Hot h{ fd, -1 };
+
+        if (_freeSlots.empty())
+            return (h);
+        struct io_uring_files_update update = {};
+        update.offset = static_cast<uint32_t>(_freeSlots.back());
+        update.fds = reinterpret_cast<uint64_t>(&fd);
+        if (this->registerCall(IORING_REGISTER_FILES_UPDATE, &update, 1) == 1) {
+            h.slot = _freeSlots.back();
+            _freeSlots.pop_back();
+        }
+        return (h);
+    }
+    /**
+     * @brief Release the slot of a hot descriptor, before closing it
+     */
+    void cool(Hot &h)
+    {
+        if (h.slot == -1)
+            return;
+        int none = -1;
+        struct io_uring_files_update update = {};
+        update.offset = static_cast<uint32_t>(h.slot);
+        update.fds = reinterpret_cast<uint64_t>(&none);
+        this->registerCall(IORING_REGISTER_FILES_UPDATE, &update, 1);
+        _freeSlots.push_back(h.slot);
+        h.slot = -1;
+    }
+    /**
+     * @brief Receive on a hot descriptor
+     * @param buffer index of the registered buffer holding 'buf', -1 if none
+     */
+    bool read(const Hot &h, char *buf, std::size_t len, uint64_t user, int buffer = -1)
+    {
+        if (h.slot == -1 && buffer == -1)
+            return (this->read(h.fd, buf, len, user));
+        // sockets ignore the offset of fixed-buffer reads
+        struct io_uring_sqe *sqe = this->prepare(buffer == -1 ? IORING_OP_RECV : IORING_OP_READ_FIXED,
+                                                 h.slot == -1 ? h.fd : h.slot, user);
+        if (sqe == nullptr)
+            return (false);
+        sqe->flags = h.slot == -1 ? 0 : IOSQE_FIXED_FILE;
+        sqe->addr = reinterpret_cast<uint64_t>(buf);
+        sqe->len = static_cast<uint32_t>(len);
+        sqe->buf_index = static_cast<uint16_t>(buffer == -1 ? 0 : buffer);
+        return (true);
+    }
+    /**
+     * @brief Send on a hot descriptor
+     * @param buffer index of the registered buffer holding 'buf', -1 if none
+     * Writes from a registered buffer go through write(2), which raises SIGPIPE
+     * on a reset connection: ignore that signal when using them.
+     */
+    bool write(const Hot &h, const char *buf, std::size_t len, uint64_t user, int buffer = -1)
+    {
+        if (h.slot == -1 && buffer == -1)
+            return (this->write(h.fd, buf, len, user));
+        struct io_uring_sqe *sqe = this->prepare(buffer == -1 ? IORING_OP_SEND : IORING_OP_WRITE_FIXED,
+                                                 h.slot == -1 ? h.fd : h.slot, user);
+        if (sqe == nullptr)
+            return (false);
+        sqe->flags = h.slot == -1 ? 0 : IOSQE_FIXED_FILE;
+        sqe->addr = reinterpret_cast<uint64_t>(buf);
+        sqe->len = static_cast<uint32_t>(len);
+        if (buffer == -1)
+            sqe->msg_flags = MSG_NOSIGNAL;
+        else
+            sqe->buf_index = static_cast<uint16_t>(buffer);
+        return (true);
+    }
+
+    /**
+     * @brief Make the next operation depend on the last one (IOSQE_IO_LINK)
+     * The kernel starts the next operation once the last one completed, and
+     * cancels it with -ECANCELED if the last one failed. A send and the recv
+     * of its response prepared this way cost one submission. Only operations
+     * not yet submitted can be linked, and a chain must fit in the ring.
+     */
+    bool link()
+    {
+        if (_last == nullptr) {
+            _errno = EINVAL;
+            return (false);
+        }
+        _last->flags |= IOSQE_IO_LINK;
+        return (true);
+    }
+    /**
+     * @brief Cancel the last operation with -ECANCELED if still pending after 'ms' milliseconds
+     * Uses IORING_OP_LINK_TIMEOUT, so the kernel keeps the timer with the
+     * operation; its own completion is not reported.
+     */
+    bool linkTimeout(int ms)
+    {
+        if (!this->link())
+            return (false);
+        struct __kernel_timespec &ts = _timeouts[_localTail & _sqMask];
+        ts = { ms / 1000, (ms % 1000) * 1000000LL };
+        struct io_uring_sqe *sqe = this->prepare(IORING_OP_LINK_TIMEOUT, -1, INTERNAL);
+        if (sqe == nullptr)
+            return (false);
+        sqe->addr = reinterpret_cast<uint64_t>(&ts);
+        sqe->len = 1;
+        _last = nullptr;
+        return (true);
+    }
+
+    /**
+     * @brief Hand queued operations to the kernel
+     * @return number of operations submitted, -1 on error
+     */
+    int submit()
+    {
+        return (this->enter(0, 0, nullptr));
+    }
+    /**
+     * @brief Submit queued operations and wait for completions
+     * @param out array receiving completions
+     * @param max size of the array
+     * @param timeout maximum wait in milliseconds, -1 to wait indefinitely, 0
+     * to poll (without a system call when a polling thread submits)
+     * @return number of completions, -1 on error
+     */
+    int wait(IoCompletion *out, int max, int timeout)
+    {
+        int n = this->reap(out, max);
+        if (n > 0 || (_sqpoll && timeout == 0)) {
+            this->submit();
+            return (n > 0 ? n : this->reap(out, max));
+        }
+        auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        while (true) {
+            struct __kernel_timespec ts = {};
+            if (timeout >= 0) {
+                auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(until - std::chrono::steady_clock::now());
+                long long ns = std::max<long long>(0, left.count());
+                ts = { ns / 1000000000, ns % 1000000000 };
+            }
+            unsigned head = *_cqHead;
+            if (this->enter(1, IORING_ENTER_GETEVENTS, timeout < 0 ? nullptr : &ts) == -1
+                && _errno != ETIME && _errno != EINTR)
+                return (-1);
+            n = this->reap(out, max);
+            // wait again if only the engine's own completions arrived, within the timeout
+            if (n > 0 || *_cqHead == head || (timeout >= 0 && std::chrono::steady_clock::now() >= until))
+                return (n);
+        }
+    }
+
+private:
+    Stats _stats{};
+
+    void setup(unsigned entries, struct io_uring_params &params)
+    {
+        _fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (_fd == -1) {
+            _errno = errno;
+            return;
+        }
+        _features = params.features;
+        _sqpoll = params.flags & IORING_SETUP_SQPOLL;
+        _sqEntries = params.sq_entries;
+        _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single)
+            _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+        _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+        if (_sqRing != MAP_FAILED)
+            _cqRing = single ? _sqRing
+                : mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+        void *sqes = MAP_FAILED;
+        if (_cqRing != MAP_FAILED)
+            sqes = mmap(nullptr, _sqEntries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            _errno = errno;
+            return;
+        }
+        char *sq = static_cast<char *>(_sqRing);
+        char *cq = static_cast<char *>(_cqRing);
+        _sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        _sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        _sqFlags = reinterpret_cast<unsigned *>(sq + params.sq_off.flags);
+        _sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        _cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        _cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        _cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+        // slot i of the submission ring always holds entry i
+        unsigned *array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < _sqEntries; ++i)
+            array[i] = i;
+        _localTail = *_sqTail;
+        _sqes = static_cast<struct io_uring_sqe *>(sqes);
+        _timeouts.resize(_sqEntries);
+    }
+
+    /**
+     * @brief Get a cleared submission entry, submitting first if the ring is full
+     */
+    struct io_uring_sqe *prepare(uint8_t opcode, int fd, uint64_t user)
+    {
+        // a polling thread frees entries by itself, wait for it rather than fail
+        if (_localTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) == _sqEntries
+            && (this->enter(0, _sqpoll ? IORING_ENTER_SQ_WAIT : 0, nullptr) == -1
+                || _localTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) == _sqEntries)) {
+            _errno = EBUSY;
+            return (nullptr);
+        }
+        struct io_uring_sqe *sqe = &_sqes[_localTail++ & _sqMask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->user_data = user;
+        _last = sqe;
+        return (sqe);
+    }
+
+    /**
+     * @brief Publish queued entries and call io_uring_enter(2)
+     */
+    int enter(unsigned minComplete, unsigned flags, struct __kernel_timespec *ts)
+    {
+        struct io_uring_getevents_arg arg = {};
+
+        if (ts != nullptr && (_features & IORING_FEAT_EXT_ARG) == 0) {
+            // kernels before 5.11 take no timeout argument: queue a timeout that
+            // completes after 'ts' or as soon as another completion arrives
+            struct __kernel_timespec &copy = _timeouts[_localTail & _sqMask];
+            copy = *ts;
+            struct io_uring_sqe *sqe = this->prepare(IORING_OP_TIMEOUT, -1, INTERNAL);
+            if (sqe == nullptr)
+                return (-1);
+            sqe->addr = reinterpret_cast<uint64_t>(&copy);
+            sqe->len = 1;
+            sqe->off = minComplete;
+            ts = nullptr;
+        }
+        bool fresh = *_sqTail != _localTail;
+        __atomic_store_n(_sqTail, _localTail, __ATOMIC_RELEASE);
+        _last = nullptr;
+        // entries the kernel has not consumed yet, including ones a failed call left behind
+        unsigned count = _localTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+        if (count == 0 && minComplete == 0 && (flags & IORING_ENTER_SQ_WAIT) == 0)
+            return (0);
+        if (fresh)
+            ++_stats.submits;
+        if (_sqpoll) {
+            // order the tail store before reading the flag the idling thread sets;
+            // it stays set until the woken thread runs, so wake once per submission
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            bool idle = __atomic_load_n(_sqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP;
+            if (idle && (fresh || (flags & IORING_ENTER_SQ_WAIT) != 0)) {
+                flags |= IORING_ENTER_SQ_WAKEUP;
+                ++_stats.wakeups;
+            } else if (minComplete == 0 && (flags & IORING_ENTER_SQ_WAIT) == 0) {
+                return (static_cast<int>(count));
+            }
+        }
+        if (ts != nullptr) {
+            arg.ts = reinterpret_cast<uint64_t>(ts);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+        ++_stats.enters;
+        int ret = static_cast<int>(syscall(__NR_io_uring_enter, _fd, count, minComplete, flags,
+                                           ts != nullptr ? static_cast<void *>(&arg) : nullptr, sizeof(arg)));
+        if (ret == -1)
+            _errno = errno;
+        return (ret);
+    }
+
+    int registerCall(unsigned opcode, const void *arg, unsigned count)
+    {
+        int ret = static_cast<int>(syscall(__NR_io_uring_register, _fd, opcode, arg, count));
+        if (ret == -1)
+            _errno = errno;
+        return (ret);
+    }
+
+    int reap(IoCompletion *out, int max)
+    {
+        unsigned head = *_cqHead;
+        unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+        int n = 0;
+
+        for (; head != tail && n < max; ++head) {
+            const struct io_uring_cqe &cqe = _cqes[head & _cqMask];
+            if (cqe.user_data != INTERNAL)
+                out[n++] = IoCompletion{ cqe.user_data, cqe.res, cqe.flags };
+        }
+        __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+        return (n);
+    }
+};
+
+#if defined(LIBSOCKET_USE_IO_URING)
+using IoEngine = UringEngine;
+#else
+using IoEngine = EpollEngine;
+#endif
@@ -0,0 +1,414 @@
+/*
+* LibSocket C++ binding
+* Header-only NUMA topology discovery, thread placement and node-local memory
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @brief CPUs of each NUMA node, read from /sys at startup
+ * A machine without NUMA information is one node holding every CPU. A
+ * simulated topology splits the CPUs of a single-node box into several
+ * nodes, so node-aware code paths run and can be benchmarked there; memory
+ * policies are then not applied, as the nodes do not exist.
+ */
+class NumaTopology
+{
+private:
+    std::vector<std::vector<int>> _cpus;
+    std::vector<int> _nodes;
+    bool _simulated{ false };
+
+public:
+    /**
+     * @brief Read the topology of this machine
+     */
+    static NumaTopology discover()
+    {
+        NumaTopology topo;
+        std::string online;
+
+        std::ifstream("/sys/devices/system/node/online") >> online;
+        std::vector<int> ids;
+        if (parseCpuList(online, ids)) {
+            for (int id : ids) {
+                std::string list;
+                std::vector<int> cpus;
+                std::ifstream("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist") >> list;
+                // memory-only nodes have no CPU to run a loop on
+                if (parseCpuList(list, cpus) && !cpus.empty()) {
+                    topo._nodes.push_back(id);
+                    topo._cpus.push_back(std::move(cpus));
+                }
+            }
+        }
+        if (topo._cpus.empty()) {
+            topo._nodes.assign(1, 0);
+            topo._cpus.assign(1, allowedCpus());
+        }
+        return (topo);
+    }
+    /**
+     * @brief Pretend the CPUs this process may use form 'nodes' nodes
+     * With fewer CPUs than nodes, nodes share CPUs.
+     */
+    static NumaTopology simulate(unsigned nodes)
+    {
+        NumaTopology topo;
+        std::vector<int> cpus = allowedCpus();
+
+        topo._simulated = true;
+        topo._cpus.resize(nodes == 0 ? 1 : nodes);
+        for (unsigned n = 0; n < topo._cpus.size(); ++n) {
+            topo._nodes.push_back(static_cast<int>(n));
+            for (std::size_t i = n; i < std::max(cpus.size(), topo._cpus.size()); i += topo._cpus.size())
+                topo._cpus[n].push_back(cpus[i % cpus.size()]);
+        }
+        return (topo);
+    }
+
+    /**
+     * @brief Number of nodes with CPUs, indexed from 0 in this class
+     */
+    inline unsigned nodes() const
+    {
+        return (static_cast<unsigned>(_cpus.size()));
+    }
+    /**
+     * @brief Kernel id of a node, as used by memory policies
+     */
+    inline int id(unsigned node) const
+    {
+        return (_nodes[node]);
+    }
+    /**
+     * @brief CPUs of a node
+     */
+    inline const std::vector<int> &cpus(unsigned node) const
+    {
+        return (_cpus[node]);
+    }
+    inline bool simulated() const
+    {
+        return (_simulated);
+    }
+    /**
+     * @brief Node of a CPU, 0 if unknown
+     */
+    unsigned nodeOf(int cpu) const
+    {
+        for (unsigned n = 0; n < _cpus.size(); ++n)
+            for (int c : _cpus[n])
+                if (c == cpu)
+                    return (n);
+        return (0);
+    }
+    /**
+     * @brief Node of the CPU the calling thread runs on
+     */
+    inline unsigned currentNode() const
+    {
+        return (this->nodeOf(sched_getcpu()));
+    }
+
+    /**
+     * @brief Restrict the calling thread to the CPUs of a node
+     * Memory it touches first then comes from that node; run an event loop
+     * this way before it accepts or allocates anything.
+     */
+    bool pin(unsigned node) const
+    {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        for (int cpu : _cpus[node])
+            CPU_SET(cpu, &set);
+        return (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0);
+    }
+    /**
+     * @brief Restrict the calling thread to one CPU
+     */
+    static bool pinCpu(int cpu)
+    {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0);
+    }
+
+    /**
+     * @brief Place the pages of a range on a node, with mbind(2)
+     * MPOL_PREFERRED: when the node runs out of memory, pages come from
+     * another one rather than failing. Does nothing on a simulated topology.
+     * @param move also migrate pages already allocated
+     */
+    bool bind(void *addr, std::size_t len, unsigned node, bool move = false) const
+    {
+        // numaif.h lives in libnuma, which we do not depend on
+        const int MPOL_PREFERRED_ = 1;
+        const unsigned MPOL_MF_MOVE_ = 1 << 1;
+        const int MASK_BITS = static_cast<int>(sizeof(unsigned long) * 8);
+
+        if (_simulated)
+            return (true);
+        if (node >= _nodes.size() || _nodes[node] >= MASK_BITS) {
+            errno = EINVAL;
+            return (false);
+        }
+        unsigned long mask = 1UL << _nodes[node];
+        // maxnode counts one more than the bits in the mask
+        return (syscall(__NR_mbind, addr, len, MPOL_PREFERRED_, &mask, sizeof(mask) * 8 + 1, move ? MPOL_MF_MOVE_ : 0) == 0);
+    }
+    /**
+     * @brief Kernel id of the node holding the page at 'addr', -1 if not allocated or unknown
+     */
+    static int nodeOfPage(const void *addr)
+    {
+        const int MPOL_F_NODE_ = 1, MPOL_F_ADDR_ = 2;
+        int node = -1;
+
+        if (syscall(__NR_get_mempolicy, &node, nullptr, 0, addr, MPOL_F_NODE_ | MPOL_F_ADDR_) == -1)
+            return (-1);
+        return (node);
+    }
+
+    /**
+     * @brief Parse a list such as "0-3,8,10-11"
+     */
+    static bool parseCpuList(std::string_view list, std::vector<int> &out)
+    {
+        out.clear();
+        while (!list.empty()) {
+            std::size_t comma = list.find(',');
+            std::string_view item = list.substr(0, comma);
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            std::size_t dash = item.find('-');
+            int first = 0, last = 0;
+            if (!parseInt(item.substr(0, dash), first)
+                || !parseInt(dash == std::string_view::npos ? item : item.substr(dash + 1), last) || last < first)
+                return (false);
+            for (int cpu = first; cpu <= last; ++cpu)
+                out.push_back(cpu);
+        }
+        return (!out.empty());
+    }
+
+private:
+    static bool parseInt(std::string_view text, int &value)
+    {
+        value = 0;
+        if (text.empty())
+            return (false);
+        for (char c : text) {
+            if (c < '0' || c > '9')
+                return (false);
+            value = value * 10 + (c - '0');
+        }
+        return (true);
+    }
+
+    static std::vector<int> allowedCpus()
+    {
+        cpu_set_t set;
+        std::vector<int> cpus;
+
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0)
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                if (CPU_ISSET(cpu, &set))
+                    cpus.push_back(cpu);
+        if (cpus.empty())
+            cpus.push_back(0);
+        return (cpus);
+    }
+};
+
+/**
+ * @brief Memory resource handing out memory placed on one NUMA node
+ * Memory is mapped in chunks bound to the node with mbind(2) and touched by
+ * the allocating thread, so placement holds under first-touch as well.
+ * Deallocation is a no-op until destruction: put a pool on top, e.g.
+ *
+ *     NodeMemoryResource node(topo, 1);
+ *     std::pmr::unsynchronized_pool_resource pool(&node);
+ *
+ * Not thread-safe, meant to be owned by the event loop thread of the node.
+ */
+class NodeMemoryResource : public std::pmr::memory_resource
+{
+public:
+    /**
+     * @brief Default chunk size, the size of a transparent huge page
+     */
+    static constexpr std::size_t CHUNK_SIZE = 2 << 20;
+
+private:
+    struct Chunk
+    {
+        void *addr;
+        std::size_t len;
+    };
+
+    const NumaTopology &_topo;
+    unsigned _node;
+    std::size_t _chunkSize;
+    std::vector<Chunk> _chunks;
+    char *_cur{ nullptr };
+    std::size_t _left{ 0 };
+
+public:
+    /**
+     * @brief Construct a resource for a node
+     * @param topo topology, must outlive the resource
+     * @param node node index in 'topo'
+     * @param chunkSize bytes mapped at once
+     */
+    NodeMemoryResource(const NumaTopology &topo, unsigned node, std::size_t chunkSize = CHUNK_SIZE)
+        : _topo{ topo }, _node{ node }, _chunkSize{ chunkSize }
+    {
+    }
+    NodeMemoryResource(const NodeMemoryResource &) = delete;
+    NodeMemoryResource &operator=(const NodeMemoryResource &) = delete;
+    ~NodeMemoryResource()
+    {
+        for (const Chunk &chunk : _chunks)
+            munmap(chunk.addr, chunk.len);
+    }
+
+    inline unsigned node() const
+    {
+        return (_node);
+    }
+    /**
+     * @brief Bytes mapped so far
+     */
+    std::size_t mapped() const
+    {
+        std::size_t total = 0;
+        for (const Chunk &chunk : _chunks)
+            total += chunk.len;
+        return (total);
+    }
+
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        std::size_t pad = (alignment - reinterpret_cast<uintptr_t>(_cur) % alignment) % alignment;
+        if (_cur == nullptr || pad + bytes > _left) {
+            // requests larger than a chunk get a mapping of their own
+            std::size_t len = std::max(_chunkSize, (bytes + alignment + 4095) & ~std::size_t(4095));
+            char *addr = static_cast<char *>(this->map(len));
+            if (len > _chunkSize)
+                return (addr);
+            _cur = addr;
+            _left = len;
+            pad = 0;
+        }
+        void *p = _cur + pad;
+        _cur += pad + bytes;
+        _left -= pad + bytes;
+        return (p);
+    }
+    void do_deallocate(void *, std::size_t, std::size_t) override
+    {
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return (this == &other);
+    }
+
+private:
+    void *map(std::size_t len)
+    {
+        void *addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED)
+            throw std::bad_alloc();
+        _topo.bind(addr, len, _node);
+        // fault the pages in now, on the node, rather than on the hot path
+        for (std::size_t off = 0; off < len; off += 4096)
+            static_cast<volatile char *>(addr)[off] = 0;
+        _chunks.push_back(Chunk{ addr, len });
+        return (addr);
+    }
+};
+
+/**
+ * @brief Fixed-size I/O buffers from one node, recycled through a free list
+ * Not thread-safe: each event loop thread owns the pool of its node.
+ */
+class BufferPool
+{
+private:
+    NodeMemoryResource _memory;
+    std::size_t _size;
+    std::vector<char *> _free;
+    std::size_t _total{ 0 };
+
+public:
+    /**
+     * @brief Construct a pool
+     * @param topo topology, must outlive the pool
+     * @param node node index in 'topo'
+     * @param size bytes per buffer
+     */
+    BufferPool(const NumaTopology &topo, unsigned node, std::size_t size)
+        : _memory{ topo, node }, _size{ size }
+    {
+    }
+
+    inline std::size_t bufferSize() const
+    {
+        return (_size);
+    }
+    /**
+     * @brief Number of buffers ever created
+     */
+    inline std::size_t total() const
+    {
+        return (_total);
+    }
+    inline unsigned node() const
+    {
+        return (_memory.node());
+    }
+
+    /**
+     * @brief Take a buffer of bufferSize() bytes
+     */
+    char *acquire()
+    {
+        if (_free.empty()) {
+            ++_total;
+            return (static_cast<char *>(_memory.allocate(_size, 64)));
+        }
+        char *buf = _free.back();
+        _free.pop_back();
+        return (buf);
+    }
+    /**
+     * @brief Give back a buffer taken from this pool
+     */
+    void release(char *buf)
+    {
+        _free.push_back(buf);
+    }
+};
@@ -0,0 +1,323 @@
+/*
+* LibSocket C++ binding
+* Header-only asynchronous hostname resolver with caching
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "EventLoop.hpp"
+
+/**
+ * @brief Asynchronous hostname resolution on an EventLoop
+ * getaddrinfo(3) runs on a small pool of worker threads, so /etc/hosts,
+ * nsswitch and the system resolver configuration are honored, while results
+ * are delivered on the loop's thread through an eventfd. Concurrent lookups of
+ * the same name share one query, and answers are cached for a fixed TTL as
+ * getaddrinfo does not expose record TTLs; failures are cached for a shorter
+ * one.
+ */
+class Resolver
+{
+public:
+    /**
+     * @brief Resolved addresses, port set to 0
+     */
+    using Addresses = std::vector<struct sockaddr_storage>;
+    /**
+     * @brief Completion callback, 'error' is 0 or an EAI_* code (see gai_strerror(3))
+     */
+    using Callback = std::function<void(int error, const Addresses &addrs)>;
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Entry
+    {
+        int error;
+        Addresses addrs;
+        Clock::time_point expires;
+    };
+
+    /**
+     * @brief Cache size below which expired answers are left alone
+     */
+    static constexpr std::size_t SWEEP_MIN = 64;
+
+    struct Job
+    {
+        std::string key;
+        int family;
+        int error;
+        Addresses addrs;
+    };
+
+    EventLoop &_loop;
+    Clock::duration _ttl;
+    Clock::duration _negativeTtl;
+    int _efd{ -1 };
+    std::unordered_map<std::string, Entry> _cache;
+    // cache size that triggers the next sweep of expired answers
+    std::size_t _sweepAt{ SWEEP_MIN };
+    std::unordered_map<std::string, std::vector<Callback>> _pending;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<Job> _jobs;
+    std::vector<Job> _done;
+    bool _stopping{ false };
+    std::vector<std::thread> _workers;
+    uint64_t _queries{ 0 };
+
+public:
+    /**
+     * @brief Construct a resolver
+     * @param loop event loop receiving the results
+     * @param threads number of worker threads
+     * @param ttl lifetime of cached answers
+     * @param negativeTtl lifetime of cached failures
+     */
+    Resolver(EventLoop &loop, int threads = 2,
+             Clock::duration ttl = std::chrono::seconds(60),
+             Clock::duration negativeTtl = std::chrono::seconds(5))
+        : _loop{ loop }, _ttl{ ttl }, _negativeTtl{ negativeTtl },
+          _efd{ eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) }
+    {
+        if (_efd == -1 || !_loop.add(_efd, EPOLLIN, [this](uint32_t) { this->onDone(); }))
+            return;
+        for (int i = 0; i < threads; ++i)
+            _workers.emplace_back([this]() { this->work(); });
+    }
+    Resolver(const Resolver &) = delete;
+    Resolver &operator=(const Resolver &) = delete;
+    ~Resolver()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _cv.notify_all();
+        for (std::thread &worker : _workers)
+            worker.join();
+        if (_efd != -1) {
+            _loop.remove(_efd);
+            ::close(_efd);
+        }
+    }
+
+    /**
+     * @brief Check if the resolver was successfully created
+     */
+    inline bool good() const
+    {
+        return (!_workers.empty());
+    }
+
+    /**
+     * @brief Resolve a hostname
+     * Numeric addresses and cached names complete immediately, from within
+     * this call; others complete later from the loop. Must be called from the
+     * loop's thread.
+     * @param host hostname or numeric address
+     * @param cb completion callback
+     * @param family AF_INET, AF_INET6 or AF_UNSPEC for both
+     */
+    void resolve(const std::string &host, Callback cb, int family = AF_UNSPEC)
+    {
+        Addresses addrs;
+        if (numeric(host.c_str(), family, addrs)) {
+            cb(0, addrs);
+            return;
+        }
+        std::string key = std::to_string(family) + '/' + host;
+        auto it = _cache.find(key);
+        if (it != _cache.end()) {
+            if (Clock::now() < it->second.expires) {
+                cb(it->second.error, it->second.addrs);
+                return;
+            }
+            _cache.erase(it);
+        }
+        std::vector<Callback> &waiting = _pending[key];
+        waiting.push_back(std::move(cb));
+        if (waiting.size() > 1)
+            return;
+        ++_queries;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _jobs.push_back(Job{ std::move(key), family, 0, Addresses() });
+        }
+        _cv.notify_one();
+    }
+
+    /**
+     * @brief Forget every cached answer
+     */
+    void clear()
+    {
+        _cache.clear();
+    }
+    /**
+     * @brief Number of queries handed to getaddrinfo so far
+     */
+    inline uint64_t queries() const
+    {
+        return (_queries);
+    }
+    /**
+     * @brief Number of answers held in the cache, expired ones included until swept
+     */
+    inline std::size_t cached() const
+    {
+        return (_cache.size());
+    }
+
+    /**
+     * @brief Find the first IPv4 address of a result
+     * @param addrs resolved addresses
+     * @param addr set to the address, in network byte order
+     * @return false if there is none
+     */
+    static bool ipv4(const Addresses &addrs, in_addr_t &addr)
+    {
+        for (const struct sockaddr_storage &ss : addrs)
+            if (ss.ss_family == AF_INET) {
+                addr = reinterpret_cast<const struct sockaddr_in &>(ss).sin_addr.s_addr;
+                return (true);
+            }
+        return (false);
+    }
+
+private:
+    /**
+     * @brief Parse a numeric IPv4 or IPv6 address
+     */
+    static bool numeric(const char *host, int family, Addresses &addrs)
+    {
+        struct sockaddr_storage ss = {};
+
+        if (family != AF_INET6) {
+            auto &sin = reinterpret_cast<struct sockaddr_in &>(ss);
+            if (inet_pton(AF_INET, host, &sin.sin_addr) == 1) {
+                sin.sin_family = AF_INET;
+                addrs.push_back(ss);
+                return (true);
+            }
+        }
+        if (family != AF_INET) {
+            auto &sin6 = reinterpret_cast<struct sockaddr_in6 &>(ss);
+            if (inet_pton(AF_INET6, host, &sin6.sin6_addr) == 1) {
+                sin6.sin6_family = AF_INET6;
+                addrs.push_back(ss);
+                return (true);
+            }
+        }
+        return (false);
+    }
+
+    /**
+     * @brief Worker thread: run queued lookups and hand results to the loop
+     */
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        while (true) {
+            _cv.wait(lock, [this]() { return (_stopping || !_jobs.empty()); });
+            if (_stopping)
+                return;
+            Job job = std::move(_jobs.front());
+            _jobs.pop_front();
+            lock.unlock();
+            this->lookup(job);
+            lock.lock();
+            _done.push_back(std::move(job));
+            uint64_t one = 1;
+            (void)!::write(_efd, &one, sizeof(one));
+        }
+    }
+
+    static void lookup(Job &job)
+    {
+        struct addrinfo hints = {};
+        struct addrinfo *res = nullptr;
+
+        hints.ai_family = job.family;
+        hints.ai_socktype = SOCK_STREAM;
+        const char *host = job.key.c_str() + job.key.find('/') + 1;
+        job.error = getaddrinfo(host, nullptr, &hints, &res);
+        if (job.error != 0)
+            return;
+        for (struct addrinfo *ai = res; ai != nullptr; ai = ai->ai_next) {
+            struct sockaddr_storage ss = {};
+            std::memcpy(&ss, ai->ai_addr, ai->ai_addrlen);
+            job.addrs.push_back(ss);
+        }
+        freeaddrinfo(res);
+    }
+
+    /**
+     * @brief Loop side: cache finished lookups and run their callbacks
+     */
+    void onDone()
+    {
+        uint64_t count = 0;
+        std::vector<Job> done;
+
+        if (::read(_efd, &count, sizeof(count)) == -1)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            done.swap(_done);
+        }
+        Clock::time_point now = Clock::now();
+        if (_cache.size() >= _sweepAt)
+            this->sweep(now);
+        for (Job &job : done) {
+            Entry &entry = _cache[job.key];
+            entry.error = job.error;
+            entry.addrs = job.addrs;
+            entry.expires = now + (job.error == 0 ? _ttl : _negativeTtl);
+            auto it = _pending.find(job.key);
+            if (it == _pending.end())
+                continue;
+            std::vector<Callback> waiting = std::move(it->second);
+            _pending.erase(it);
+            // callbacks may resolve again, so they get the job's copy
+            for (Callback &cb : waiting)
+                cb(job.error, job.addrs);
+        }
+    }
+
+    /**
+     * @brief Drop expired answers, which names never looked up again would keep forever
+     * Runs once the cache doubled since the last sweep, so that its cost
+     * spreads over the insertions.
+     */
+    void sweep(Clock::time_point now)
+    {
+        for (auto it = _cache.begin(); it != _cache.end();) {
+            if (it->second.expires <= now)
+                it = _cache.erase(it);
+            else
+                ++it;
+        }
+        _sweepAt = std::max(SWEEP_MIN, _cache.size() * 2);
+    }
+};
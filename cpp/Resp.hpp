@@ -0,0 +1,605 @@
+/*
+* LibSocket C++ binding
+* Header-only Redis RESP2/RESP3 codec, pipelined client and server
+*/
+
+#pragma once
+
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/uio.h>
+
+#include "ConnectionHost.hpp"
+#include "EventLoop.hpp"
+#include "Socket.hpp"
+
+/**
+ * @brief RESP value, a node of a flattened (pre-order) value tree
+ * Strings are views into the parsed buffer. An Attribute node directly
+ * precedes the value it annotates and is not counted as a child.
+ */
+struct RespValue
+{
+    /**
+     * @brief RESP type, valued after its type byte
+     */
+    enum Type : char {
+        SimpleString = '+',
+        Error = '-',
+        Integer = ':',
+        BulkString = '$',
+        Array = '*',
+        Null = '_',
+        Boolean = '#',
+        Double = ',',
+        BigNumber = '(',
+        BulkError = '!',
+        VerbatimString = '=',
+        Map = '%',
+        Set = '~',
+        Push = '>',
+        Attribute = '|'
+    };
+
+    Type type{ Null };
+    std::string_view str;
+    int64_t integer{ 0 };
+    double dbl{ 0 };
+    /**
+     * @brief Number of direct children of an aggregate (twice the pairs for maps)
+     */
+    std::size_t count{ 0 };
+    /**
+     * @brief Index of the node following this value's subtree
+     */
+    std::size_t next{ 0 };
+
+    /**
+     * @brief Check whether the value is an aggregate holding children
+     */
+    inline bool isAggregate() const
+    {
+        return (type == Array || type == Map || type == Set || type == Push || type == Attribute);
+    }
+};
+
+/**
+ * @brief Streaming RESP2/RESP3 parser
+ * Values are parsed into a reusable node vector, so bulk strings cost no
+ * allocation. An incomplete value is parsed again from its start once more
+ * data is available.
+ */
+class RespParser
+{
+public:
+    /**
+     * @brief Result of a parse call
+     */
+    enum Status { Complete, Incomplete, Invalid };
+
+    /**
+     * @brief Maximum nesting depth of aggregates, attributes before a value included
+     */
+    static constexpr int MAX_DEPTH = 32;
+    /**
+     * @brief Maximum size of a bulk string
+     */
+    static constexpr int64_t MAX_BULK_SIZE = 512 << 20;
+
+private:
+    bool _invalid{ false };
+
+public:
+    /**
+     * @brief Parse one top-level value from the front of a buffer
+     * @param data buffer holding received data
+     * @param len number of bytes in the buffer
+     * @param nodes cleared, then filled with the value's nodes in pre-order
+     * @param consumed set to the size of the value in the buffer when complete
+     */
+    Status parse(const char *data, std::size_t len, std::vector<RespValue> &nodes, std::size_t &consumed)
+    {
+        nodes.clear();
+        _invalid = false;
+        const char *end = this->parseValue(data, data + len, nodes, 0);
+        if (end == nullptr)
+            return (_invalid ? Invalid : Incomplete);
+        consumed = end - data;
+        return (Complete);
+    }
+
+private:
+    /**
+     * @brief Find the end of a CRLF-terminated line
+     * @return pointer to the '\r', or nullptr if the line is incomplete
+     */
+    const char *findLine(const char *p, const char *end)
+    {
+        const char *cr = static_cast<const char *>(std::memchr(p, '\r', end - p));
+        if (cr == nullptr || cr + 1 >= end)
+            return (nullptr);
+        if (cr[1] != '\n')
+            return (this->fail());
+        return (cr);
+    }
+
+    const char *fail()
+    {
+        _invalid = true;
+        return (nullptr);
+    }
+
+    bool parseInteger(const char *p, const char *end, int64_t &value)
+    {
+        auto res = std::from_chars(p, end, value);
+        return (res.ec == std::errc() && res.ptr == end && p != end);
+    }
+
+    const char *parseValue(const char *p, const char *end, std::vector<RespValue> &nodes, int depth)
+    {
+        if (p >= end)
+            return (nullptr);
+        if (depth > MAX_DEPTH)
+            return (this->fail());
+        const char *eol = this->findLine(p + 1, end);
+        if (eol == nullptr)
+            return (nullptr);
+        std::size_t index = nodes.size();
+        nodes.emplace_back();
+        RespValue &node = nodes.back();
+        node.type = static_cast<RespValue::Type>(*p);
+        node.str = std::string_view(p + 1, eol - p - 1);
+        const char *next = eol + 2;
+
+        switch (*p) {
+        case RespValue::SimpleString:
+        case RespValue::Error:
+        case RespValue::BigNumber:
+            break;
+        case RespValue::Integer:
+            if (!this->parseInteger(node.str.data(), eol, node.integer))
+                return (this->fail());
+            break;
+        case RespValue::Double: {
+            auto res = std::from_chars(node.str.data(), eol, node.dbl);
+            if (res.ec != std::errc() || res.ptr != eol)
+                return (this->fail());
+            break;
+        }
+        case RespValue::Boolean:
+            if (node.str != "t" && node.str != "f")
+                return (this->fail());
+            node.integer = (node.str == "t");
+            break;
+        case RespValue::Null:
+            if (!node.str.empty())
+                return (this->fail());
+            break;
+        case RespValue::BulkString:
+        case RespValue::BulkError:
+        case RespValue::VerbatimString: {
+            int64_t size = 0;
+            if (!this->parseInteger(node.str.data(), eol, size) || size < -1 || size > MAX_BULK_SIZE)
+                return (this->fail());
+            if (size == -1) {
+                node.type = RespValue::Null;
+                node.str = std::string_view();
+                break;
+            }
+            if (end - next < size + 2)
+                return (nullptr);
+            if (next[size] != '\r' || next[size + 1] != '\n')
+                return (this->fail());
+            node.str = std::string_view(next, size);
+            next += size + 2;
+            break;
+        }
+        case RespValue::Array:
+        case RespValue::Set:
+        case RespValue::Push:
+        case RespValue::Map:
+        case RespValue::Attribute: {
+            int64_t count = 0;
+            if (!this->parseInteger(node.str.data(), eol, count) || count < -1 || count > INT_MAX)
+                return (this->fail());
+            if (count == -1) {
+                node.type = RespValue::Null;
+                node.str = std::string_view();
+                break;
+            }
+            if (*p == RespValue::Map || *p == RespValue::Attribute)
+                count *= 2;
+            node.count = count;
+            node.str = std::string_view();
+            for (int64_t i = 0; i < count && next != nullptr; ++i)
+                next = this->parseValue(next, end, nodes, depth + 1);
+            if (next == nullptr)
+                return (nullptr);
+            break;
+        }
+        default:
+            return (this->fail());
+        }
+        nodes[index].next = nodes.size();
+        // the annotated value follows; each attribute counts as a level so that a run of them cannot exhaust the stack
+        if (nodes[index].type == RespValue::Attribute)
+            return (this->parseValue(next, end, nodes, depth + 1));
+        return (next);
+    }
+};
+
+/**
+ * @brief RESP serializer appending to a string
+ */
+class RespWriter
+{
+private:
+    std::string &_out;
+
+public:
+    /**
+     * @brief Construct a writer appending to an output buffer
+     * @param out output buffer
+     */
+    RespWriter(std::string &out)
+        : _out{ out }
+    {
+    }
+
+    /**
+     * @brief Write a command as an array of bulk strings
+     * @param args command name and arguments
+     */
+    RespWriter &command(std::initializer_list<std::string_view> args)
+    {
+        this->header(RespValue::Array, args.size());
+        for (std::string_view arg : args)
+            this->bulk(arg);
+        return (*this);
+    }
+    /**
+     * @brief Write an aggregate header, to be followed by its elements
+     * @param type aggregate type
+     * @param count number of elements (of pairs for maps)
+     */
+    RespWriter &header(RespValue::Type type, int64_t count)
+    {
+        char num[24];
+        auto res = std::to_chars(num, num + sizeof(num), count);
+
+        _out.push_back(type);
+        _out.append(num, res.ptr - num);
+        _out.append("\r\n");
+        return (*this);
+    }
+    /**
+     * @brief Write a bulk string
+     * @param str string data
+     */
+    RespWriter &bulk(std::string_view str)
+    {
+        this->header(RespValue::BulkString, str.size());
+        _out.append(str);
+        _out.append("\r\n");
+        return (*this);
+    }
+    /**
+     * @brief Write a simple string
+     * @param str string, must not contain CR or LF
+     */
+    RespWriter &simple(std::string_view str)
+    {
+        _out.push_back(RespValue::SimpleString);
+        _out.append(str);
+        _out.append("\r\n");
+        return (*this);
+    }
+    /**
+     * @brief Write an error
+     * @param str error message, must not contain CR or LF
+     */
+    RespWriter &error(std::string_view str)
+    {
+        _out.push_back(RespValue::Error);
+        _out.append(str);
+        _out.append("\r\n");
+        return (*this);
+    }
+    /**
+     * @brief Write an integer
+     * @param value integer value
+     */
+    RespWriter &integer(int64_t value)
+    {
+        return (this->header(RespValue::Integer, value));
+    }
+    /**
+     * @brief Write a null, as the RESP2 null bulk string or the RESP3 null
+     * @param resp3 whether the peer speaks RESP3
+     */
+    RespWriter &null(bool resp3 = false)
+    {
+        _out.append(resp3 ? "_\r\n" : "$-1\r\n");
+        return (*this);
+    }
+};
+
+/**
+ * @brief Pipelined RESP client over a blocking Socket
+ * Commands are queued until flush(), which sends them all with one writev(2).
+ * Arguments larger than INLINE_SIZE are not copied: they must stay valid
+ * until flush() returns.
+ */
+class RespClient
+{
+public:
+    /**
+     * @brief Arguments up to this size are copied into the command buffer
+     */
+    static constexpr std::size_t INLINE_SIZE = 256;
+
+private:
+    struct Segment
+    {
+        const char *ptr;
+        std::size_t offset;
+        std::size_t len;
+    };
+
+    Socket &_sock;
+    RespParser _parser;
+    std::string _out;
+    std::vector<Segment> _segments;
+    std::vector<struct iovec> _iov;
+    std::size_t _cut{ 0 };
+    std::size_t _pending{ 0 };
+    std::size_t _consumed{ 0 };
+
+public:
+    /**
+     * @brief Construct a client over a connected socket
+     * @param sock connected socket
+     */
+    RespClient(Socket &sock)
+        : _sock{ sock }
+    {
+    }
+
+    /**
+     * @brief Queue a command
+     * @param args command name and arguments
+     */
+    void send(std::initializer_list<std::string_view> args)
+    {
+        RespWriter writer(_out);
+
+        writer.header(RespValue::Array, args.size());
+        for (std::string_view arg : args) {
+            if (arg.size() <= INLINE_SIZE) {
+                writer.bulk(arg);
+                continue;
+            }
+            writer.header(RespValue::BulkString, arg.size());
+            this->cut();
+            _segments.push_back({ arg.data(), 0, arg.size() });
+            _out.append("\r\n");
+        }
+        ++_pending;
+    }
+
+    /**
+     * @brief Send all queued commands
+     */
+    bool flush()
+    {
+        this->cut();
+        _iov.clear();
+        for (const Segment &seg : _segments) {
+            const char *base = seg.ptr ? seg.ptr : _out.data() + seg.offset;
+            _iov.push_back({ const_cast<char *>(base), seg.len });
+        }
+        std::size_t first = 0;
+        while (first < _iov.size() && _sock.good()) {
+            int count = static_cast<int>(std::min<std::size_t>(_iov.size() - first, IOV_MAX));
+            _sock.writev(&_iov[first], count);
+            std::size_t written = _sock.gcount();
+            while (first < _iov.size() && written >= _iov[first].iov_len)
+                written -= _iov[first++].iov_len;
+            if (first < _iov.size()) {
+                _iov[first].iov_base = static_cast<char *>(_iov[first].iov_base) + written;
+                _iov[first].iov_len -= written;
+            }
+        }
+        _out.clear();
+        _segments.clear();
+        _cut = 0;
+        return (_sock.good());
+    }
+
+    /**
+     * @brief Receive the next reply
+     * Views in nodes stay valid until the next call.
+     * @param nodes filled with the reply's nodes in pre-order
+     */
+    bool receive(std::vector<RespValue> &nodes)
+    {
+        std::size_t consumed = 0;
+
+        _sock.consume(_consumed);
+        _consumed = 0;
+        while (true) {
+            RespParser::Status status = _parser.parse(_sock.bufferedData(), _sock.bufferedSize(), nodes, consumed);
+            if (status == RespParser::Complete)
+                break;
+            if (status == RespParser::Invalid || _sock.fill() <= 0)
+                return (false);
+        }
+        _consumed = consumed;
+        if (_pending > 0)
+            --_pending;
+        return (true);
+    }
+
+    /**
+     * @brief Number of sent commands whose reply was not received yet
+     */
+    inline std::size_t pending() const
+    {
+        return (_pending);
+    }
+
+private:
+    /**
+     * @brief Close the current inline segment of the command buffer
+     */
+    void cut()
+    {
+        if (_cut < _out.size())
+            _segments.push_back({ nullptr, _cut, _out.size() - _cut });
+        _cut = _out.size();
+    }
+};
+
+/**
+ * @brief Minimal RESP server running on an EventLoop
+ * Replies to pipelined commands received together are sent with a single write.
+ */
+class RespServer
+{
+public:
+    /**
+     * @brief Command handler
+     * Receives the command's nodes: nodes[0] is the array, its elements follow.
+     */
+    using Handler = std::function<void(const std::vector<RespValue> &, RespWriter &)>;
+
+private:
+    struct Connection
+    {
+        Socket sock;
+        std::string out;
+        std::size_t outpos{ 0 };
+        bool closing{ false };
+        bool writing{ false };
+        uint64_t requests{ 0 };
+
+        Connection(Socket &&s)
+            : sock{ std::move(s) }
+        {
+        }
+    };
+
+    EventLoop &_loop;
+    Handler _handler;
+    Socket _listener;
+    RespParser _parser;
+    std::vector<RespValue> _nodes;
+    ConnectionHost<Connection> _conns;
+
+public:
+    /**
+     * @brief Construct a new server
+     * @param loop event loop driving the server
+     * @param handler command handler
+     */
+    RespServer(EventLoop &loop, Handler handler)
+        : _loop{ loop }, _handler{ std::move(handler) }, _conns{ loop, [this](Connection &conn) { this->process(conn); } }
+    {
+    }
+    RespServer(const RespServer &) = delete;
+    RespServer &operator=(const RespServer &) = delete;
+    ~RespServer()
+    {
+        if (_listener.isOpen())
+            _loop.remove(_listener.fd());
+    }
+
+    /**
+     * @brief Listen to connections on given endpoint
+     * @param ep endpoint to listen to
+     * @param count amount of connections to listen to
+     */
+    bool listen(const Endpoint &ep, int count = SOMAXCONN)
+    {
+        _listener.listen(ep, count);
+        _listener.setBlocking(false);
+        return (_listener.good() && _loop.add(_listener.fd(), EPOLLIN, [this](uint32_t) { this->onAccept(); }));
+    }
+    /**
+     * @brief Listen to connections on given port and address
+     * @param port port to listen to, in network byte order
+     * @param addr address to listen to, in network byte order
+     * @param count amount of connections to listen to
+     */
+    bool listen(in_port_t port, in_addr_t addr, int count = SOMAXCONN)
+    {
+        return (this->listen(Endpoint::ipv4(ntohl(addr), ntohs(port)), count));
+    }
+
+    /**
+     * @brief Get the descriptors of the open connections
+     * Like every member below, call from the loop's thread.
+     */
+    std::vector<int> connections() const
+    {
+        return (_conns.connections());
+    }
+    /**
+     * @brief Get the number of commands a connection sent so far, 0 if unknown
+     */
+    uint64_t requests(int fd) const
+    {
+        return (_conns.requests(fd));
+    }
+    /**
+     * @brief Move a live connection to a server running on another loop
+     * Buffered input and pending output move along, and the connection
+     * stays open. Call outside the server's callbacks, from a posted task
+     * for instance; 'target' adopts it on its own loop's thread.
+     * @return false if 'fd' is not a connection of this server
+     */
+    bool migrate(int fd, RespServer &target)
+    {
+        return (_conns.migrate(fd, target._conns));
+    }
+
+private:
+    void onAccept()
+    {
+        while (true) {
+            Socket client = _listener.accept();
+            if (!client.isOpen())
+                return;
+            client.setBlocking(false);
+            _conns.adopt(std::make_shared<Connection>(std::move(client)));
+        }
+    }
+
+    void process(Connection &conn)
+    {
+        RespWriter writer(conn.out);
+        std::size_t consumed = 0;
+
+        while (true) {
+            RespParser::Status status = _parser.parse(conn.sock.bufferedData(), conn.sock.bufferedSize(), _nodes, consumed);
+            if (status == RespParser::Incomplete)
+                return;
+            if (status == RespParser::Invalid || _nodes[0].type != RespValue::Array || _nodes[0].count == 0) {
+                writer.error("ERR Protocol error");
+                conn.closing = true;
+                return;
+            }
+            ++conn.requests;
+            _handler(_nodes, writer);
+            conn.sock.consume(consumed);
+        }
+    }
+};
@@ -0,0 +1,357 @@
+/*
+* LibSocket C++ binding
+* Header-only multiplexed RPC client and server
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ConnectionHost.hpp"
+#include "EventLoop.hpp"
+#include "FlatMap.hpp"
+#include "Frame.hpp"
+#include "Socket.hpp"
+
+/**
+ * @brief RPC message layout: a frame holding a 64-bit big-endian request id, then the body
+ */
+struct RpcMessage
+{
+    /**
+     * @brief Size of the request id
+     */
+    static constexpr std::size_t ID_SIZE = 8;
+
+    /**
+     * @brief Append a message to an output buffer
+     * @param out output buffer
+     * @param id request id
+     * @param body message body
+     * @param checksum append a CRC32C trailer to the frame
+     * @return false, leaving 'out' unchanged, if the message exceeds Frame::MAX_SIZE
+     */
+    static bool write(std::string &out, uint64_t id, std::string_view body, bool checksum = false)
+    {
+        std::size_t offset = Frame::begin(out);
+        char bytes[ID_SIZE];
+        ByteOrder::store<Endian::Big>(bytes, id);
+        out.append(bytes, ID_SIZE);
+        out.append(body);
+        return (Frame::end(out, offset, checksum));
+    }
+    /**
+     * @brief Split a frame payload into request id and body
+     * @param payload frame payload
+     * @param id set to the request id
+     * @param body set to the message body
+     * @return false if the payload is too short
+     */
+    static bool read(std::string_view payload, uint64_t &id, std::string_view &body)
+    {
+        if (payload.size() < ID_SIZE)
+            return (false);
+        id = ByteOrder::load<Endian::Big, uint64_t>(payload.data());
+        body = payload.substr(ID_SIZE);
+        return (true);
+    }
+};
+
+/**
+ * @brief Multiplexed RPC client running on an EventLoop
+ * Any number of requests may be in flight on the connection; responses are
+ * matched to requests by id in any order. Requests issued during one loop
+ * iteration are sent together with a single write.
+ */
+class RpcClient
+{
+public:
+    /**
+     * @brief Response callback, 'ok' is false if the connection failed first
+     */
+    using Callback = std::function<void(bool ok, std::string_view response)>;
+
+private:
+    EventLoop &_loop;
+    Socket _sock;
+    std::string _out;
+    std::size_t _outpos{ 0 };
+    bool _writing{ false };
+    uint64_t _nextId{ 1 };
+    FlatMap<Callback> _inflight;
+    FrameReader _reader;
+
+public:
+    /**
+     * @brief Construct a client over a connected socket
+     * @param loop event loop driving the client
+     * @param sock connected socket, switched to non-blocking mode
+     * @param checksum protect frames with CRC32C, must match the server
+     */
+    RpcClient(EventLoop &loop, Socket &&sock, bool checksum = false)
+        : _loop{ loop }, _sock{ std::move(sock) }, _inflight{ 1024 }, _reader{ checksum }
+    {
+        _sock.setBlocking(false);
+        if (_sock.good())
+            _loop.add(_sock.fd(), EPOLLIN, [this](uint32_t events) { this->onEvent(events); });
+    }
+    RpcClient(const RpcClient &) = delete;
+    RpcClient &operator=(const RpcClient &) = delete;
+    ~RpcClient()
+    {
+        if (_sock.isOpen())
+            _loop.remove(_sock.fd());
+    }
+
+    /**
+     * @brief Issue a request
+     * Must be called from the loop's thread. A request larger than
+     * Frame::MAX_SIZE fails at once, calling 'cb' with 'ok' false.
+     * @param request request body
+     * @param cb callback invoked with the response
+     * @return request id
+     */
+    uint64_t call(std::string_view request, Callback cb)
+    {
+        uint64_t id = _nextId++;
+
+        if (!_sock.good() || !RpcMessage::write(_out, id, request, _reader.checksum())) {
+            cb(false, std::string_view());
+            return (id);
+        }
+        _inflight.insert(id, std::move(cb));
+        if (!_writing) {
+            _writing = true;
+            _loop.modify(_sock.fd(), EPOLLIN | EPOLLOUT);
+        }
+        return (id);
+    }
+
+    /**
+     * @brief Number of requests waiting for a response
+     */
+    inline std::size_t inflight() const
+    {
+        return (_inflight.size());
+    }
+    /**
+     * @brief Check whether the connection is usable
+     */
+    inline bool good() const
+    {
+        return (_sock.good());
+    }
+
+private:
+    void onEvent(uint32_t events)
+    {
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            while (_sock.fill() > 0 && this->process())
+                ;
+        if (_sock.good() && (events & EPOLLOUT))
+            this->flush();
+        if (!_sock.good())
+            this->fail();
+    }
+
+    bool process()
+    {
+        std::string_view payload;
+        std::string_view body;
+        std::size_t consumed = 0;
+        uint64_t id = 0;
+        Callback cb;
+
+        while (true) {
+            Frame::Status status = _reader.parse(_sock.bufferedData(), _sock.bufferedSize(), payload, consumed);
+            if (status == Frame::Incomplete)
+                return (true);
+            if (status == Frame::Invalid || !RpcMessage::read(payload, id, body)) {
+                _sock.setstate(std::ios::failbit);
+                return (false);
+            }
+            if (_inflight.take(id, cb))
+                cb(true, body);
+            _sock.consume(consumed);
+        }
+    }
+
+    void flush()
+    {
+        while (_outpos < _out.size()) {
+            _sock.write(_out.data() + _outpos, _out.size() - _outpos);
+            if (_sock.gcount() == 0)
+                break;
+            _outpos += _sock.gcount();
+        }
+        if (_outpos == _out.size()) {
+            _out.clear();
+            _outpos = 0;
+            _writing = false;
+            _loop.modify(_sock.fd(), EPOLLIN);
+        }
+    }
+
+    /**
+     * @brief Close the connection and fail every request in flight
+     */
+    void fail()
+    {
+        if (_sock.isOpen()) {
+            _loop.remove(_sock.fd());
+            _sock.close();
+        }
+        FlatMap<Callback> inflight(0);
+        std::swap(inflight, _inflight);
+        inflight.forEach([](uint64_t, Callback &cb) { cb(false, std::string_view()); });
+    }
+};
+
+/**
+ * @brief Multiplexed RPC server running on an EventLoop
+ * Responses to requests received together are sent with a single write.
+ */
+class RpcServer
+{
+public:
+    /**
+     * @brief Request handler, appends the response body to 'response'
+     */
+    using Handler = std::function<void(std::string_view request, std::string &response)>;
+
+private:
+    struct Connection
+    {
+        Socket sock;
+        FrameReader reader;
+        std::string out;
+        std::size_t outpos{ 0 };
+        bool closing{ false };
+        bool writing{ false };
+        uint64_t requests{ 0 };
+
+        Connection(Socket &&s, bool checksum)
+            : sock{ std::move(s) }, reader{ checksum }
+        {
+        }
+    };
+
+    EventLoop &_loop;
+    Handler _handler;
+    bool _checksum;
+    Socket _listener;
+    std::string _response;
+    ConnectionHost<Connection> _conns;
+
+public:
+    /**
+     * @brief Construct a new server
+     * @param loop event loop driving the server
+     * @param handler request handler
+     * @param checksum protect frames with CRC32C, must match the clients
+     */
+    RpcServer(EventLoop &loop, Handler handler, bool checksum = false)
+        : _loop{ loop }, _handler{ std::move(handler) }, _checksum{ checksum }, _conns{ loop, [this](Connection &conn) { this->process(conn); } }
+    {
+    }
+    RpcServer(const RpcServer &) = delete;
+    RpcServer &operator=(const RpcServer &) = delete;
+    ~RpcServer()
+    {
+        if (_listener.isOpen())
+            _loop.remove(_listener.fd());
+    }
+
+    /**
+     * @brief Listen to connections on given endpoint
+     * @param ep endpoint to listen to
+     * @param count amount of connections to listen to
+     */
+    bool listen(const Endpoint &ep, int count = SOMAXCONN)
+    {
+        _listener.listen(ep, count);
+        _listener.setBlocking(false);
+        return (_listener.good() && _loop.add(_listener.fd(), EPOLLIN, [this](uint32_t) { this->onAccept(); }));
+    }
+    /**
+     * @brief Listen to connections on given port and address
+     * @param port port to listen to, in network byte order
+     * @param addr address to listen to, in network byte order
+     * @param count amount of connections to listen to
+     */
+    bool listen(in_port_t port, in_addr_t addr, int count = SOMAXCONN)
+    {
+        return (this->listen(Endpoint::ipv4(ntohl(addr), ntohs(port)), count));
+    }
+
+    /**
+     * @brief Get the descriptors of the open connections
+     * Like every member below, call from the loop's thread.
+     */
+    std::vector<int> connections() const
+    {
+        return (_conns.connections());
+    }
+    /**
+     * @brief Get the number of requests a connection made so far, 0 if unknown
+     */
+    uint64_t requests(int fd) const
+    {
+        return (_conns.requests(fd));
+    }
+    /**
+     * @brief Move a live connection to a server running on another loop
+     * Buffered input, parser state and pending output move along, and the
+     * connection stays open. Call outside the server's callbacks, from a
+     * posted task for instance; 'target' adopts it on its own loop's thread.
+     * @return false if 'fd' is not a connection of this server
+     */
+    bool migrate(int fd, RpcServer &target)
+    {
+        return (_conns.migrate(fd, target._conns));
+    }
+
+private:
+    void onAccept()
+    {
+        while (true) {
+            Socket client = _listener.accept();
+            if (!client.isOpen())
+                return;
+            client.setBlocking(false);
+            _conns.adopt(std::make_shared<Connection>(std::move(client), _checksum));
+        }
+    }
+
+    void process(Connection &conn)
+    {
+        std::string_view payload;
+        std::string_view body;
+        std::size_t consumed = 0;
+        uint64_t id = 0;
+
+        while (true) {
+            Frame::Status status = conn.reader.parse(conn.sock.bufferedData(), conn.sock.bufferedSize(), payload, consumed);
+            if (status == Frame::Incomplete)
+                return;
+            if (status == Frame::Invalid || !RpcMessage::read(payload, id, body)) {
+                conn.closing = true;
+                return;
+            }
+            _response.clear();
+            ++conn.requests;
+            _handler(body, _response);
+            conn.sock.consume(consumed);
+            // a response too large to frame cannot be delivered: the client sees the connection close
+            if (!RpcMessage::write(conn.out, id, _response, _checksum)) {
+                conn.closing = true;
+                return;
+            }
+        }
+    }
+};
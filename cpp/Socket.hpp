@@ -6,22 +6,82 @@
 #pragma once
 
 #include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <climits>
 #include <cstdio>
 #include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <linux/filter.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 
+#include "Endian.hpp"
+#include "Endpoint.hpp"
+#if defined(LIBSOCKET_BUFFER_ARENA)
+#include "BufferArena.hpp"
+#endif
+
 /**
  * @brief TCP socket wrapper
  */
 class Socket : public std::ios
 {
+public:
+    /**
+     * @brief Initial and smallest size of the receive buffer
+     */
+    static constexpr std::size_t RBUF_SIZE = 4096;
+    /**
+     * @brief Size up to which the receive buffer grows on bulk reads
+     * A message larger than this still gets the room it needs.
+     */
+    static constexpr std::size_t RBUF_MAX = 256 << 10;
+    /**
+     * @brief Consecutive small reads after which the receive buffer is halved
+     */
+    static constexpr unsigned RBUF_SHRINK_AFTER = 16;
+    /**
+     * @brief Size above which the send buffer is flushed automatically
+     */
+    static constexpr std::size_t WBUF_SIZE = 65536;
+
+#if defined(LIBSOCKET_BUFFER_ARENA)
+    using Allocator = ArenaAllocator<char>;
+#else
+    using Allocator = std::allocator<char>;
+#endif
+    /**
+     * @brief Receive buffer type
+     */
+    using ReadBuffer = std::vector<char, Allocator>;
+    /**
+     * @brief Send buffer type
+     */
+    using WriteBuffer = std::basic_string<char, std::char_traits<char>, Allocator>;
+
 private:
     int _sd{ -1 };
     int _errno{ 0 };
+    std::streamsize _count{ 0 };
+    ReadBuffer _rbuf;
+    std::size_t _rbeg{ 0 };
+    std::size_t _rend{ 0 };
+    std::size_t _rsize{ RBUF_SIZE };
+    unsigned _rsmall{ 0 };
+    WriteBuffer _wbuf;
 
 public:
     /**
@@ -32,6 +92,7 @@ public:
         : _sd{ sd }
     {
         int state = 1;
+        this->precision(6);
         if (setsockopt(_sd, SOL_SOCKET, SO_REUSEADDR, &state, sizeof(state)) == -1)
             this->setstate(failbit);
         if (!*this)
@@ -45,10 +106,31 @@ public:
         : Socket(socket(PF_INET, SOCK_STREAM, 0))
     {
     }
-    Socket(const Socket &&other)
-        : _sd{ std::move(other._sd) }
+    /**
+     * @brief Construct a new socket of given domain and type
+     * @param domain address family, e.g. AF_INET6
+     * @param type socket type, e.g. SOCK_STREAM
+     */
+    Socket(int domain, int type)
+        : Socket(socket(domain, type, 0))
     {
     }
+    Socket(Socket &&other)
+        : _sd{ std::exchange(other._sd, -1) },
+          _errno{ other._errno },
+          _count{ other._count },
+          _rbuf{ std::move(other._rbuf) },
+          _rbeg{ std::exchange(other._rbeg, 0) },
+          _rend{ std::exchange(other._rend, 0) },
+          _rsize{ other._rsize },
+          _rsmall{ other._rsmall },
+          _wbuf{ std::move(other._wbuf) }
+    {
+        this->flags(other.flags());
+        this->precision(other.precision());
+        if (!other.good())
+            this->setstate(other.rdstate());
+    }
     ~Socket()
     {
         if (this->isOpen())
@@ -57,8 +139,9 @@ public:
 
     /**
      * @brief Listen to 'count' connections on given port and address
-     * @param port port to listen to
-     * @param addr address to listen to
+     * Prefer the Endpoint overload, which takes the port in host byte order.
+     * @param port port to listen to, in network byte order
+     * @param addr address to listen to, in network byte order
      * @param count amount of connections to listen to
      */
     void listen(in_port_t port, in_addr_t addr, int count)
@@ -68,17 +151,37 @@ public:
             .sin_port = port,
             .sin_addr = { .s_addr = addr }
         };
-        socklen_t addrlen = sizeof(st_addr);
 
-        if (this->good() && ::bind(_sd, (const struct sockaddr *)&st_addr, addrlen) == -1)
+        this->listen((const struct sockaddr *)&st_addr, sizeof(st_addr), count);
+    }
+    /**
+     * @brief Listen to 'count' connections on given address of the socket's family
+     * @param addr address to listen to
+     * @param addrlen size of the address
+     * @param count amount of connections to listen to
+     */
+    void listen(const struct sockaddr *addr, socklen_t addrlen, int count)
+    {
+        if (this->good() && ::bind(_sd, addr, addrlen) == -1)
             this->setstate(failbit);
         if (this->good() && ::listen(_sd, count) == -1)
             this->setstate(failbit);
         _errno = errno;
     }
+    /**
+     * @brief Listen to 'count' connections on given endpoint
+     * The socket is recreated if its family differs from the endpoint's.
+     * @param ep endpoint to listen to
+     * @param count amount of connections to listen to
+     */
+    void listen(const Endpoint &ep, int count = SOMAXCONN)
+    {
+        if (this->setFamily(ep))
+            this->listen(ep.addr(), ep.length(), count);
+    }
     /**
      * @brief Listen to 'count' connections on given port and address
-     * @param port port to listen to
+     * @param port port to listen to, in network byte order
      * @param addr address (as a dot-separated string) to listen to
      * @param count amount of connections to listen to
      */
@@ -96,20 +199,38 @@ public:
      */
     Socket accept()
     {
-        struct sockaddr_in st_addr = { 0 };
+        struct sockaddr_storage st_addr = {};
+        socklen_t addrlen = sizeof(st_addr);
+
+        int peersd = -1;
+        if (this->good())
+            peersd = ::accept(_sd, (struct sockaddr *)&st_addr, &addrlen);
+        _errno = errno;
+        return (Socket(peersd));
+    }
+    /**
+     * @brief Accept an incoming connection on current socket
+     * @param peer set to the address of the client
+     * @return connected client socket
+     */
+    Socket accept(Endpoint &peer)
+    {
+        struct sockaddr_storage st_addr = {};
         socklen_t addrlen = sizeof(st_addr);
 
         int peersd = -1;
         if (this->good())
             peersd = ::accept(_sd, (struct sockaddr *)&st_addr, &addrlen);
         _errno = errno;
+        peer = peersd != -1 ? Endpoint((const struct sockaddr *)&st_addr, addrlen) : Endpoint();
         return (Socket(peersd));
     }
 
     /**
      * @brief Connect to a remote address and port
-     * @param port remote server port to connect to
-     * @param addr remote server address to connect to
+     * Prefer the Endpoint overload, which takes the port in host byte order.
+     * @param port remote server port to connect to, in network byte order
+     * @param addr remote server address to connect to, in network byte order
      */
     void connect(in_port_t port, in_addr_t addr)
     {
@@ -118,15 +239,41 @@ public:
             .sin_port = port,
             .sin_addr = { .s_addr = addr }
         };
-        socklen_t addrlen = sizeof(st_addr);
 
-        if (this->good() && ::connect(_sd, (const struct sockaddr *)&st_addr, addrlen) == -1)
-            this->setstate(failbit);
+        this->connect((const struct sockaddr *)&st_addr, sizeof(st_addr));
+    }
+    /**
+     * @brief Connect to a remote address of the socket's family
+     * On a non-blocking socket, a connection still in progress sets no error
+     * bit and errcode() returns EINPROGRESS; wait for writability, then check
+     * pendingError().
+     * @param addr remote address
+     * @param addrlen size of the address
+     */
+    void connect(const struct sockaddr *addr, socklen_t addrlen)
+    {
+        if (this->good() && ::connect(_sd, addr, addrlen) == -1) {
+            // on a blocking socket, EINPROGRESS means SO_SNDTIMEO expired
+            int err = errno;
+            if (err != EINPROGRESS || (fcntl(_sd, F_GETFL, 0) & O_NONBLOCK) == 0)
+                this->setstate(failbit);
+            errno = err;
+        }
         _errno = errno;
     }
+    /**
+     * @brief Connect to a remote endpoint
+     * The socket is recreated if its family differs from the endpoint's.
+     * @param ep remote endpoint
+     */
+    void connect(const Endpoint &ep)
+    {
+        if (this->setFamily(ep))
+            this->connect(ep.addr(), ep.length());
+    }
     /**
      * @brief Connect to a remote address and port
-     * @param port remote server port to connect to
+     * @param port remote server port to connect to, in network byte order
      * @param addrstr remote server address (as a dot-separated string) to connect to
      */
     void connect(in_port_t port, const char *addrstr)
@@ -138,10 +285,12 @@ public:
     }
 
     /**
-     * @brief Close socket connection
+     * @brief Close socket connection, flushing the send buffer first
      */
     void close()
     {
+        if (!_wbuf.empty())
+            this->flush();
         if (::close(_sd) == -1) {
             this->setstate(failbit);
         } else {
@@ -159,6 +308,160 @@ public:
         return (_sd != -1);
     }
 
+    /**
+     * @brief Get the underlying socket descriptor
+     */
+    inline int fd() const
+    {
+        return (_sd);
+    }
+
+    /**
+     * @brief Switch socket between blocking and non-blocking mode
+     * @param state true for blocking operations, false for non-blocking
+     */
+    void setBlocking(bool state)
+    {
+        int flags = fcntl(_sd, F_GETFL, 0);
+
+        if (flags != -1)
+            flags = fcntl(_sd, F_SETFL, state ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+        if (flags == -1)
+            this->setstate(failbit);
+        _errno = errno;
+    }
+
+    /**
+     * @brief Enable or disable Nagle's algorithm
+     * @param state true to send small segments immediately
+     */
+    void setNoDelay(bool state)
+    {
+        int optval = state;
+
+        if (setsockopt(_sd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval)) == -1)
+            this->setstate(failbit);
+        _errno = errno;
+    }
+    /**
+     * @brief Fetch and clear the pending socket error, e.g. of a non-blocking connect
+     * @return SO_ERROR value, 0 if none; a non-zero value also sets failbit
+     */
+    int pendingError()
+    {
+        int optval = 0;
+        socklen_t optlen = sizeof(optval);
+
+        if (getsockopt(_sd, SOL_SOCKET, SO_ERROR, &optval, &optlen) == -1)
+            optval = errno;
+        if (optval != 0) {
+            this->setstate(failbit);
+            _errno = optval;
+        }
+        return (optval);
+    }
+
+
+    /**
+     * @brief Reallocate the receive and send buffers from the calling thread
+     * Pages go to the NUMA node of the thread touching them first: after
+     * handing the socket to a thread on another node, call this from there.
+     */
+    void relocate()
+    {
+        this->reallocate(_rbuf.size());
+        WriteBuffer wbuf;
+        wbuf.reserve(_wbuf.capacity());
+        wbuf.append(_wbuf);
+        _wbuf.swap(wbuf);
+    }
+    /**
+     * @brief Reallocate a string held next to the socket from the calling thread
+     * Moving a std::string keeps its heap block where it was: copy it into a
+     * fresh one so that its pages follow the socket's buffers.
+     */
+    static void relocate(std::string &buf)
+    {
+        std::string copy;
+        copy.reserve(buf.capacity());
+        copy.append(buf);
+        buf.swap(copy);
+    }
+
+    /**
+     * @brief Let several sockets listen on the same endpoint (SO_REUSEPORT)
+     * Set before listen(); the kernel then spreads incoming connections over
+     * the group, one listener per worker thread.
+     * @param state true to join a group
+     */
+    void setReusePort(bool state)
+    {
+        int optval = state;
+
+        if (setsockopt(_sd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) == -1)
+            this->setstate(failbit);
+        _errno = errno;
+    }
+    /**
+     * @brief Get the CPU that last processed this socket's packets (SO_INCOMING_CPU)
+     * On an accepted socket, the CPU that ran the network stack for its
+     * handshake: handling the connection there keeps its data in cache.
+     * @return CPU number, -1 if unknown
+     */
+    int incomingCpu()
+    {
+        int cpu = -1;
+        socklen_t optlen = sizeof(cpu);
+
+        if (getsockopt(_sd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &optlen) == -1) {
+            _errno = errno;
+            return (-1);
+        }
+        return (cpu);
+    }
+    /**
+     * @brief Route connections to the listener matching the receiving CPU
+     * Attaches a classic BPF program (SO_ATTACH_REUSEPORT_CBPF) to this
+     * listener's SO_REUSEPORT group that picks listener 'cpu % count', in the
+     * order listeners joined the group: with the worker owning listener i
+     * pinned to CPU i, packet processing and the application share a cache.
+     * Call after listen(); closing a listener reorders the group.
+     * @param count number of listeners in the group
+     */
+    bool steerByCpu(unsigned count)
+    {
+        struct sock_filter code[] = {
+            { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+            { BPF_ALU | BPF_MOD | BPF_K, 0, 0, count },
+            { BPF_RET | BPF_A, 0, 0, 0 },
+        };
+        struct sock_fprog prog = { sizeof(code) / sizeof(code[0]), code };
+
+        if (count == 0 || setsockopt(_sd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == -1) {
+            _errno = count == 0 ? EINVAL : errno;
+            return (false);
+        }
+        return (true);
+    }
+
+    /**
+     * @brief Get number of bytes transferred by the last read or write
+     */
+    inline std::streamsize gcount() const
+    {
+        return (_count);
+    }
+    /**
+     * @brief Check whether the last write of at least one byte failed
+     * Decided from the system call alone: the stream state is no guide, as
+     * reading the end of stream of a half-closed connection sets badbit too
+     * while writing still works. A write that would block did not fail.
+     */
+    inline bool writeFailed() const
+    {
+        return (_count == 0 && !wouldBlock(_errno) && _errno != EINTR);
+    }
+
     /**
      * @brief Get error code
      * @return getsockopt(2) error code or errno value
@@ -185,48 +488,502 @@ public:
 
     /**
      * @brief Read from socket
+     * Data already held in the receive buffer is returned first.
      * @param buffer buffer to read data into
      * @param len maximum number of bytes to read
      */
     Socket &read(char *buffer, std::streamsize len)
     {
+        if (_rend > _rbeg) {
+            _count = std::min<std::streamsize>(len, _rend - _rbeg);
+            std::memcpy(buffer, _rbuf.data() + _rbeg, _count);
+            this->consume(_count);
+            return (*this);
+        }
         ssize_t rdsize = ::read(_sd, buffer, len);
         _errno = errno;
+        _count = (rdsize > 0) ? rdsize : 0;
         if (rdsize == 0 && len > 0)
             this->setstate(eofbit);
-        if (rdsize == -1)
+        if (rdsize == -1 && !wouldBlock(_errno))
             this->setstate(badbit);
         return (*this);
     }
+    /**
+     * @brief Read from socket until several buffers are full
+     * Data held in the receive buffer goes first, the rest is read straight
+     * into the buffers with readv(2), looping on short reads. The entries of
+     * 'iov' are advanced past the data received, those filled left with a
+     * zero length: on a non-blocking socket, gcount() bytes were received
+     * when it would block, and calling again with the same 'iov' once more
+     * data arrives resumes.
+     * Sets failbit if the socket is closed before the buffers are full.
+     * @param iov buffers to read data into
+     * @param iovcnt number of buffers
+     */
+    Socket &readv(struct iovec *iov, int iovcnt)
+    {
+        std::size_t total = 0;
+
+        advance(iov, iovcnt, 0);
+        while (iovcnt > 0 && _rend > _rbeg) {
+            std::size_t len = std::min(iov->iov_len, _rend - _rbeg);
+            std::memcpy(iov->iov_base, _rbuf.data() + _rbeg, len);
+            this->consume(len);
+            total += len;
+            advance(iov, iovcnt, len);
+        }
+        while (iovcnt > 0 && this->good()) {
+            ssize_t rdsize = ::readv(_sd, iov, std::min(iovcnt, IOV_MAX));
+            _errno = errno;
+            if (rdsize == -1 && _errno == EINTR)
+                continue;
+            if (rdsize <= 0) {
+                if (rdsize == 0)
+                    this->setstate(eofbit);
+                else if (!wouldBlock(_errno))
+                    this->setstate(badbit);
+                break;
+            }
+            total += rdsize;
+            advance(iov, iovcnt, rdsize);
+        }
+        _count = total;
+        if (iovcnt > 0 && !this->good())
+            this->setstate(failbit);
+        return (*this);
+    }
+    /**
+     * @brief Read a fixed-size header and its payload straight into place
+     * One readv(2) call usually receives both, without going through the
+     * receive buffer. It pays off for large payloads; small messages are
+     * cheaper to batch through fill(), many per system call.
+     * The header is copied as raw bytes: fields wider than a byte are in
+     * wire order, see ByteOrder to convert them.
+     * On a non-blocking socket that would block first, gcount() is 0 and
+     * the bytes received are kept in the receive buffer, so that the same
+     * call completes once more data arrives. Sets failbit if the socket is
+     * closed before the message is complete.
+     * @param header header to fill
+     * @param payload buffer to fill with the 'len' bytes following the header
+     */
+    template <typename H>
+    Socket &readv(H &header, char *payload, std::size_t len)
+    {
+        static_assert(std::is_trivially_copyable<H>::value, "readv<H> requires a trivially copyable header");
+        struct iovec iov[2] = { { &header, sizeof(H) }, { payload, len } };
+
+        if (this->readv(iov, 2).gcount() != static_cast<std::streamsize>(sizeof(H) + len)) {
+            // nothing is buffered any more: put back what was received
+            std::size_t got = static_cast<std::size_t>(_count);
+            std::size_t head = std::min(got, sizeof(H));
+            if (_rbuf.size() < got)
+                _rbuf.resize(got);
+            std::memcpy(_rbuf.data(), &header, head);
+            std::memcpy(_rbuf.data() + head, payload, got - head);
+            _rbeg = 0;
+            _rend = got;
+            _count = 0;
+        }
+        return (*this);
+    }
     /**
      * @brief Get line from socket
+     * On a non-blocking socket, an incomplete line is kept in the receive
+     * buffer and an empty line is returned until the delimiter arrives.
      * @param buffer buffer to read data into
+     * @param delim line delimiter
      */
     Socket &getline(std::string &buffer, char delim = '\n')
     {
-        char c = -1;
+        std::size_t scanned = 0;
+
         buffer.clear();
-        while (this->read(&c, 1) && c != delim && c != '\0')
-            buffer += c;
-        if (c == '\0')
-            this->getline(buffer, delim);
-        return (*this);
+        while (true) {
+            std::string_view data = this->buffered();
+            std::size_t i = scanned;
+            while (i < data.size() && data[i] != delim && data[i] != '\0')
+                ++i;
+            if (i < data.size() && data[i] == '\0') {
+                this->consume(i + 1);
+                scanned = 0;
+                continue;
+            }
+            if (i < data.size()) {
+                buffer.assign(data.data(), i);
+                this->consume(i + 1);
+                return (*this);
+            }
+            scanned = i;
+            if (this->fill() > 0)
+                continue;
+            if (!this->good()) {
+                buffer.assign(data.data(), data.size());
+                this->consume(data.size());
+            }
+            return (*this);
+        }
+    }
+
+    /**
+     * @brief Read available data from socket into the receive buffer
+     * Views previously returned by buffered() are invalidated.
+     * The buffer adapts to the traffic from the sizes of past reads alone:
+     * it doubles, up to RBUF_MAX, after a read filled all the room offered,
+     * and halves, down to RBUF_SIZE, after RBUF_SHRINK_AFTER reads in a row
+     * used at most a quarter of it or found nothing.
+     * @return number of bytes appended to the receive buffer
+     */
+    std::streamsize fill()
+    {
+        if (_rbeg == _rend) {
+            _rbeg = 0;
+            _rend = 0;
+        }
+        if (_rbuf.size() > _rsize && _rend - _rbeg <= _rsize)
+            this->reallocate(_rsize);
+        else if (_rbuf.size() < _rsize)
+            _rbuf.resize(_rsize);
+        if (_rend == _rbuf.size() && _rbeg > 0) {
+            std::memmove(_rbuf.data(), _rbuf.data() + _rbeg, _rend - _rbeg);
+            _rend -= _rbeg;
+            _rbeg = 0;
+        }
+        if (_rend == _rbuf.size())
+            _rbuf.resize(_rbuf.size() * 2);
+        std::size_t room = _rbuf.size() - _rend;
+        ssize_t rdsize = ::read(_sd, _rbuf.data() + _rend, room);
+        _errno = errno;
+        _count = (rdsize > 0) ? rdsize : 0;
+        if (rdsize == 0)
+            this->setstate(eofbit);
+        if (rdsize == -1 && !wouldBlock(_errno))
+            this->setstate(badbit);
+        _rend += _count;
+        if (static_cast<std::size_t>(_count) == room) {
+            // more is likely pending: read it in fewer calls next time
+            _rsize = std::max(_rsize, std::min(_rbuf.size() * 2, RBUF_MAX));
+            _rsmall = 0;
+        } else if (static_cast<std::size_t>(_count) > _rbuf.size() / 4) {
+            _rsmall = 0;
+        } else if (++_rsmall >= RBUF_SHRINK_AFTER) {
+            _rsize = std::max(_rsize / 2, RBUF_SIZE);
+            _rsmall = 0;
+        }
+        return (_count);
+    }
+    /**
+     * @brief Get the current size of the receive buffer
+     */
+    inline std::size_t receiveBufferSize() const
+    {
+        return (_rbuf.size());
+    }
+    /**
+     * @brief Get a view of the data held in the receive buffer
+     */
+    inline std::string_view buffered() const
+    {
+        return (std::string_view(_rbuf.data() + _rbeg, _rend - _rbeg));
+    }
+    /**
+     * @brief Get a mutable pointer to the data held in the receive buffer
+     * Allows parsers to decode data in place, see bufferedSize() for its length.
+     */
+    inline char *bufferedData()
+    {
+        return (_rbuf.data() + _rbeg);
+    }
+    /**
+     * @brief Get number of bytes held in the receive buffer
+     */
+    inline std::size_t bufferedSize() const
+    {
+        return (_rend - _rbeg);
+    }
+    /**
+     * @brief Discard bytes from the front of the receive buffer
+     * @param len number of bytes to discard
+     */
+    void consume(std::size_t len)
+    {
+        _rbeg += std::min(len, _rend - _rbeg);
+        if (_rbeg == _rend) {
+            _rbeg = 0;
+            _rend = 0;
+        }
     }
 
     /**
      * @brief Write to socket
+     * If the send buffer holds data, buffer is appended to it and all of it
+     * is flushed, preserving order.
      * @param buffer buffer to write data from
      * @param len number of bytes to write
      */
     Socket &write(const char *buffer, std::streamsize len)
     {
-        ssize_t wrsize = ::write(_sd, buffer, len);
+        if (!_wbuf.empty()) {
+            _wbuf.append(buffer, len);
+            return (this->flush());
+        }
+        ssize_t wrsize = ::send(_sd, buffer, len, MSG_NOSIGNAL);
+        _errno = errno;
+        _count = (wrsize > 0) ? wrsize : 0;
+        if ((wrsize == 0 && len > 0) || (wrsize == -1 && !wouldBlock(_errno)))
+            this->setstate(badbit);
+        return (*this);
+    }
+
+    /**
+     * @brief Write several buffers to socket with a single system call
+     * Writing nothing, e.g. only empty buffers, succeeds without a system call.
+     * @param iov buffers to write data from
+     * @param iovcnt number of buffers
+     */
+    Socket &writev(const struct iovec *iov, int iovcnt)
+    {
+        struct msghdr msg = {};
+        msg.msg_iov = const_cast<struct iovec *>(iov);
+        msg.msg_iovlen = iovcnt;
+
+        std::size_t len = 0;
+        for (int i = 0; i < iovcnt; ++i)
+            len += iov[i].iov_len;
+        _count = 0;
+        if (len == 0)
+            return (*this);
+        ssize_t wrsize = ::sendmsg(_sd, &msg, MSG_NOSIGNAL);
         _errno = errno;
-        if ((wrsize == 0 && len > 0) || wrsize == -1)
+        _count = (wrsize > 0) ? wrsize : 0;
+        if (wrsize == 0 || (wrsize == -1 && !wouldBlock(_errno)))
             this->setstate(badbit);
         return (*this);
     }
 
+    /**
+     * @brief Send the content of the send buffer
+     * On a non-blocking socket, data that could not be sent yet stays buffered.
+     */
+    Socket &flush()
+    {
+        std::size_t pos = 0;
+
+        while (pos < _wbuf.size()) {
+            ssize_t wrsize = ::send(_sd, _wbuf.data() + pos, _wbuf.size() - pos, MSG_NOSIGNAL);
+            _errno = errno;
+            if (wrsize <= 0) {
+                if (wrsize == 0 || !wouldBlock(_errno))
+                    this->setstate(badbit);
+                break;
+            }
+            pos += wrsize;
+        }
+        _count = pos;
+        _wbuf.erase(0, pos);
+        return (*this);
+    }
+    /**
+     * @brief Get number of bytes waiting in the send buffer
+     */
+    inline std::size_t unflushed() const
+    {
+        return (_wbuf.size());
+    }
+
+    /**
+     * @brief Append a fixed-width integer or floating point value to the send buffer
+     * @param value value to append
+     * @tparam E byte order on the wire, network order by default
+     */
+    template <typename T, Endian E = Endian::Big>
+    Socket &put(T value)
+    {
+        static_assert(std::is_arithmetic<T>::value, "put<T> requires an arithmetic type");
+        char bytes[sizeof(T)];
+
+        ByteOrder::store<E>(bytes, value);
+        _wbuf.append(bytes, sizeof(T));
+        return (this->autoflush());
+    }
+    /**
+     * @brief Append an unsigned LEB128 variable-length integer to the send buffer
+     * @param value value to append
+     */
+    Socket &putVarint(uint64_t value)
+    {
+        char bytes[10];
+        std::size_t len = 0;
+
+        while (value >= 0x80) {
+            bytes[len++] = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        bytes[len++] = static_cast<char>(value);
+        _wbuf.append(bytes, len);
+        return (this->autoflush());
+    }
+    /**
+     * @brief Append a string prefixed with its varint length to the send buffer
+     * @param str string to append
+     */
+    Socket &putString(std::string_view str)
+    {
+        this->putVarint(str.size());
+        _wbuf.append(str);
+        return (this->autoflush());
+    }
+
+    /**
+     * @brief Append text to the send buffer
+     * @param str text to append
+     */
+    Socket &operator<<(std::string_view str)
+    {
+        _wbuf.append(str);
+        return (this->autoflush());
+    }
+    /**
+     * @brief Append a null-terminated string to the send buffer
+     * @param str string to append
+     */
+    Socket &operator<<(const char *str)
+    {
+        return (*this << std::string_view(str));
+    }
+    /**
+     * @brief Append a character to the send buffer
+     * @param c character to append
+     */
+    Socket &operator<<(char c)
+    {
+        _wbuf.push_back(c);
+        return (this->autoflush());
+    }
+    Socket &operator<<(signed char c)
+    {
+        return (*this << static_cast<char>(c));
+    }
+    Socket &operator<<(unsigned char c)
+    {
+        return (*this << static_cast<char>(c));
+    }
+    /**
+     * @brief Append a boolean to the send buffer, as a word with std::boolalpha
+     * @param value value to append
+     */
+    Socket &operator<<(bool value)
+    {
+        if (this->flags() & boolalpha)
+            return (*this << (value ? std::string_view("true") : std::string_view("false")));
+        return (*this << static_cast<char>('0' + value));
+    }
+    /**
+     * @brief Format a number straight into the send buffer with std::to_chars
+     * Locale facets are bypassed, otherwise the output is that of std::ostream:
+     * integers honor std::hex, std::oct, std::showbase and std::showpos,
+     * floating point values honor std::fixed, std::scientific, std::hexfloat,
+     * precision() and std::showpos, and std::uppercase applies to both but,
+     * as with std::ostream, not to std::fixed.
+     * Sets failbit, appending nothing, if the value cannot be formatted.
+     * @param value value to append
+     */
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+    Socket &operator<<(T value)
+    {
+        std::size_t pos = _wbuf.size();
+        std::size_t room = 64;
+        std::to_chars_result res;
+
+        if constexpr (std::is_floating_point<T>::value)
+            room += std::max<std::streamsize>(this->precision(), 0);
+        // fixed notation of a large value may need thousands of digits
+        do {
+            _wbuf.resize(pos + room);
+            res = this->format(&_wbuf[pos], &_wbuf[0] + _wbuf.size(), value);
+            room *= 4;
+        } while (res.ec == std::errc::value_too_large);
+        if (res.ec != std::errc()) {
+            _wbuf.resize(pos);
+            this->setstate(failbit);
+            return (*this);
+        }
+        bool fixedFloat = std::is_floating_point<T>::value && (this->flags() & floatfield) == fixed;
+        if ((this->flags() & uppercase) && !fixedFloat)
+            for (char *c = &_wbuf[pos]; c < res.ptr; ++c)
+                if (*c >= 'a' && *c <= 'z')
+                    *c -= 'a' - 'A';
+        _wbuf.resize(res.ptr - _wbuf.data());
+        return (this->autoflush());
+    }
+    /**
+     * @brief Apply a std::ios_base manipulator such as std::hex or std::fixed
+     * @param manip manipulator to apply
+     */
+    Socket &operator<<(std::ios_base &(*manip)(std::ios_base &))
+    {
+        manip(*this);
+        return (*this);
+    }
+
+    /**
+     * @brief Read a fixed-width integer or floating point value
+     * Sets failbit if the socket is closed or would block before the value is complete.
+     * @param value value to fill
+     * @tparam E byte order on the wire, network order by default
+     */
+    template <typename T, Endian E = Endian::Big>
+    Socket &get(T &value)
+    {
+        static_assert(std::is_arithmetic<T>::value, "get<T> requires an arithmetic type");
+
+        if (this->require(sizeof(T))) {
+            value = ByteOrder::load<E, T>(_rbuf.data() + _rbeg);
+            this->consume(sizeof(T));
+        }
+        return (*this);
+    }
+    /**
+     * @brief Read an unsigned LEB128 variable-length integer
+     * @param value value to fill
+     */
+    Socket &getVarint(uint64_t &value)
+    {
+        std::size_t len = 0;
+
+        value = 0;
+        while (this->require(len + 1)) {
+            uint8_t byte = _rbuf[_rbeg + len];
+            value |= static_cast<uint64_t>(byte & 0x7F) << (7 * len);
+            if (++len == 10 && byte > 1) {
+                this->setstate(failbit);
+                break;
+            }
+            if ((byte & 0x80) == 0) {
+                this->consume(len);
+                break;
+            }
+        }
+        return (*this);
+    }
+    /**
+     * @brief Read a string prefixed with its varint length
+     * @param str string to fill
+     * @param maxlen maximum accepted length, failbit is set beyond
+     */
+    Socket &getString(std::string &str, std::size_t maxlen = 16 << 20)
+    {
+        uint64_t len = 0;
+
+        if (this->getVarint(len) && len > maxlen)
+            this->setstate(failbit);
+        if (this->good() && this->require(len)) {
+            str.assign(_rbuf.data() + _rbeg, len);
+            this->consume(len);
+        }
+        return (*this);
+    }
+
     /**
      * @brief Get info about the socket
      */
@@ -251,6 +1008,30 @@ public:
             this->setstate(failbit);
         return (st_addr);
     }
+    /**
+     * @brief Get the address the socket is bound to
+     */
+    Endpoint localEndpoint() const
+    {
+        struct sockaddr_storage st_addr = {};
+        socklen_t addrlen = sizeof(st_addr);
+
+        if (getsockname(_sd, (struct sockaddr *)&st_addr, &addrlen) == -1)
+            return (Endpoint());
+        return (Endpoint((const struct sockaddr *)&st_addr, addrlen));
+    }
+    /**
+     * @brief Get the address of the connected peer
+     */
+    Endpoint peerEndpoint() const
+    {
+        struct sockaddr_storage st_addr = {};
+        socklen_t addrlen = sizeof(st_addr);
+
+        if (getpeername(_sd, (struct sockaddr *)&st_addr, &addrlen) == -1)
+            return (Endpoint());
+        return (Endpoint((const struct sockaddr *)&st_addr, addrlen));
+    }
     /**
      * @brief Get info about local loopback
      */
@@ -260,13 +1041,158 @@ public:
         socklen_t addrlen = sizeof(st_addr);
         Socket local;
 
-        local.connect(0, INADDR_LOOPBACK);
+        local.connect(in_port_t(0), INADDR_LOOPBACK);
         if (getsockname(local._sd, (struct sockaddr *)&st_addr, &addrlen) == -1)
             this->setstate(failbit);
         return (st_addr);
     }
 
 private:
+    /**
+     * @brief Format a number as operator<< does, before std::uppercase applies
+     * @param first output, with room for at least 3 characters
+     */
+    template <typename T>
+    std::to_chars_result format(char *first, char *last, T value) const
+    {
+        fmtflags f = this->flags();
+
+        if constexpr (std::is_integral<T>::value) {
+            int base = (f & basefield) == hex ? 16 : (f & basefield) == oct ? 8 : 10;
+            if (base != 10) {
+                // like std::ostream, show negative values in two's complement
+                auto bits = static_cast<std::make_unsigned_t<T>>(value);
+                if ((f & showbase) && bits != 0) {
+                    *first++ = '0';
+                    if (base == 16)
+                        *first++ = 'x';
+                }
+                return (std::to_chars(first, last, bits, base));
+            }
+            if ((f & showpos) && value >= 0 && std::is_signed<T>::value)
+                *first++ = '+';
+            return (std::to_chars(first, last, value));
+        } else {
+            fmtflags format = f & floatfield;
+            int prec = this->precision() < 0 ? 6 : static_cast<int>(this->precision());
+            if (std::signbit(value)) {
+                *first++ = '-';
+                value = -value;
+            } else if (f & showpos) {
+                *first++ = '+';
+            }
+            if (format == fixed)
+                return (std::to_chars(first, last, value, std::chars_format::fixed, prec));
+            if (format == scientific)
+                return (std::to_chars(first, last, value, std::chars_format::scientific, prec));
+            if (format != (fixed | scientific))
+                return (std::to_chars(first, last, value, std::chars_format::general, prec));
+            if (std::isfinite(value)) {
+                *first++ = '0';
+                *first++ = 'x';
+            }
+            return (std::to_chars(first, last, value, std::chars_format::hex));
+        }
+    }
+    /**
+     * @brief Skip 'len' bytes of the buffers in 'iov', dropping the ones filled
+     * Entries are updated in place, the filled ones left empty, so that the
+     * caller's array describes what is still to be read.
+     */
+    static void advance(struct iovec *&iov, int &iovcnt, std::size_t len)
+    {
+        while (iovcnt > 0 && len >= iov->iov_len) {
+            len -= iov->iov_len;
+            iov->iov_base = static_cast<char *>(iov->iov_base) + iov->iov_len;
+            iov->iov_len = 0;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + len;
+            iov->iov_len -= len;
+        }
+    }
+    /**
+     * @brief Move the buffered data to the front of a new receive buffer of 'size' bytes
+     */
+    void reallocate(std::size_t size)
+    {
+        ReadBuffer rbuf(size);
+        std::memcpy(rbuf.data(), _rbuf.data() + _rbeg, _rend - _rbeg);
+        _rbuf.swap(rbuf);
+        _rend -= _rbeg;
+        _rbeg = 0;
+    }
+    /**
+     * @brief Make the socket match the endpoint's family, recreating it if needed
+     * The descriptor number, its status flags and SO_REUSEPORT are kept.
+     * @return false if the endpoint is invalid or the socket could not be recreated
+     */
+    bool setFamily(const Endpoint &ep)
+    {
+        int domain = 0;
+        socklen_t optlen = sizeof(domain);
+
+        if (!ep.valid()) {
+            this->setstate(failbit);
+            _errno = EINVAL;
+            return (false);
+        }
+        if (!this->good() || getsockopt(_sd, SOL_SOCKET, SO_DOMAIN, &domain, &optlen) == -1 || domain == ep.family())
+            return (this->good());
+        int type = SOCK_STREAM;
+        optlen = sizeof(type);
+        getsockopt(_sd, SOL_SOCKET, SO_TYPE, &type, &optlen);
+        int reuse = 0;
+        optlen = sizeof(reuse);
+        getsockopt(_sd, SOL_SOCKET, SO_REUSEPORT, &reuse, &optlen);
+        int sd = socket(ep.family(), type, 0);
+        int flags = fcntl(_sd, F_GETFL, 0);
+        int state = 1;
+        if (sd == -1 || setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, &state, sizeof(state)) == -1
+            || (reuse && setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) == -1)
+            || fcntl(sd, F_SETFL, flags) == -1 || dup2(sd, _sd) == -1)
+            this->setstate(failbit);
+        _errno = errno;
+        if (sd != -1)
+            ::close(sd);
+        return (this->good());
+    }
+
+    /**
+     * @brief Flush the send buffer once it grows past WBUF_SIZE
+     */
+    inline Socket &autoflush()
+    {
+        if (_wbuf.size() >= WBUF_SIZE)
+            this->flush();
+        return (*this);
+    }
+    /**
+     * @brief Fill the receive buffer until it holds at least len bytes
+     * @return false, with failbit set, if the data could not be received
+     */
+    bool require(std::size_t len)
+    {
+        while (this->bufferedSize() < len) {
+            if (!this->good() || this->fill() <= 0) {
+                this->setstate(failbit);
+                return (false);
+            }
+        }
+        return (true);
+    }
+
+    /**
+     * @brief Check whether an error code means the operation would block
+     * @param err errno value
+     */
+    static inline bool wouldBlock(int err)
+    {
+        return (err == EAGAIN || err == EWOULDBLOCK);
+    }
+
     /**
      * @brief Convert IPv4 adrress from text to binary form
      * @param addrstr dot-separated IPv4 address string
@@ -275,7 +1201,7 @@ private:
     static bool strToAddr(const char *addrstr, in_addr_t *buffer)
     {
         struct sockaddr_in st_addr = { 0 };
-        if (inet_pton(AF_INET, addrstr, &(st_addr.sin_addr)) == -1)
+        if (inet_pton(AF_INET, addrstr, &(st_addr.sin_addr)) != 1)
             return (false);
         *buffer = st_addr.sin_addr.s_addr;
         return (true);
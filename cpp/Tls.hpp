@@ -0,0 +1,359 @@
+/*
+* LibSocket C++ binding
+* Header-only TLS layer over OpenSSL with kernel TLS offload
+*
+* Link with -lssl -lcrypto.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "Socket.hpp"
+
+/**
+ * @brief TLS configuration shared by the connections of one side
+ * With kernel TLS enabled, OpenSSL installs the negotiated keys into the
+ * socket (TCP_ULP "tls") after the handshake when the kernel and cipher
+ * allow it, so records are encrypted by the kernel and sendfile(2) keeps
+ * working on the encrypted connection.
+ */
+class TlsContext
+{
+public:
+    /**
+     * @brief Side of the connection the context is used for
+     */
+    enum Mode { Client, Server };
+
+private:
+    SSL_CTX *_ctx{ nullptr };
+
+public:
+    /**
+     * @brief Construct a TLS context
+     * @param mode client or server side
+     * @param ktls hand record encryption to the kernel when possible
+     */
+    TlsContext(Mode mode, bool ktls = true)
+        : _ctx{ SSL_CTX_new(mode == Server ? TLS_server_method() : TLS_client_method()) }
+    {
+        if (_ctx == nullptr)
+            return;
+        SSL_CTX_set_min_proto_version(_ctx, TLS1_2_VERSION);
+        if (ktls)
+            SSL_CTX_set_options(_ctx, SSL_OP_ENABLE_KTLS);
+        if (mode == Client) {
+            SSL_CTX_set_verify(_ctx, SSL_VERIFY_PEER, nullptr);
+            SSL_CTX_set_default_verify_paths(_ctx);
+        }
+    }
+    TlsContext(const TlsContext &) = delete;
+    TlsContext &operator=(const TlsContext &) = delete;
+    ~TlsContext()
+    {
+        SSL_CTX_free(_ctx);
+    }
+
+    /**
+     * @brief Check if the context was successfully created
+     */
+    inline bool good() const
+    {
+        return (_ctx != nullptr);
+    }
+    /**
+     * @brief Get the underlying OpenSSL context
+     */
+    inline SSL_CTX *native() const
+    {
+        return (_ctx);
+    }
+
+    /**
+     * @brief Load the certificate chain and private key from PEM files
+     * @param certFile certificate chain file
+     * @param keyFile private key file
+     */
+    bool useCertificate(const char *certFile, const char *keyFile)
+    {
+        return (SSL_CTX_use_certificate_chain_file(_ctx, certFile) == 1
+                && SSL_CTX_use_PrivateKey_file(_ctx, keyFile, SSL_FILETYPE_PEM) == 1
+                && SSL_CTX_check_private_key(_ctx) == 1);
+    }
+    /**
+     * @brief Generate a self-signed P-256 certificate, for local testing
+     * @param commonName subject common name
+     * @param days validity period
+     */
+    bool useSelfSigned(const char *commonName = "localhost", long days = 30)
+    {
+        EVP_PKEY *key = EVP_EC_gen("P-256");
+        X509 *cert = X509_new();
+        bool ok = key != nullptr && cert != nullptr;
+
+        if (ok) {
+            X509_set_version(cert, 2);
+            ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+            X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+            X509_gmtime_adj(X509_getm_notAfter(cert), days * 24 * 3600);
+            X509_set_pubkey(cert, key);
+            X509_NAME *name = X509_get_subject_name(cert);
+            X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                       reinterpret_cast<const unsigned char *>(commonName), -1, -1, 0);
+            X509_set_issuer_name(cert, name);
+            ok = X509_sign(cert, key, EVP_sha256()) > 0
+                && SSL_CTX_use_certificate(_ctx, cert) == 1
+                && SSL_CTX_use_PrivateKey(_ctx, key) == 1;
+        }
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        return (ok);
+    }
+    /**
+     * @brief Trust the certificates found in a PEM file when verifying peers
+     * @param caFile certificate authorities file
+     */
+    bool trust(const char *caFile)
+    {
+        return (SSL_CTX_load_verify_locations(_ctx, caFile, nullptr) == 1);
+    }
+    /**
+     * @brief Trust the certificate used by another context, e.g. a self-signed one
+     * @param other context holding the certificate
+     */
+    bool trust(const TlsContext &other)
+    {
+        X509 *cert = SSL_CTX_get0_certificate(other._ctx);
+        return (cert != nullptr && X509_STORE_add_cert(SSL_CTX_get_cert_store(_ctx), cert) == 1);
+    }
+
+    /**
+     * @brief Return a string describing the last OpenSSL error of this thread
+     */
+    static const char *strerror()
+    {
+        static thread_local char buffer[256];
+        ERR_error_string_n(ERR_peek_last_error(), buffer, sizeof(buffer));
+        return (buffer);
+    }
+};
+
+/**
+ * @brief TLS connection over a connected blocking Socket
+ * The handshake must start before anything is read through the Socket
+ * itself, as data held in its receive buffer is not seen by TLS. Errors are
+ * reported through the Socket's state.
+ */
+class TlsSocket
+{
+private:
+    Socket &_sock;
+    SSL *_ssl{ nullptr };
+    std::streamsize _count{ 0 };
+
+public:
+    /**
+     * @brief Construct a TLS connection over a connected socket
+     * @param sock connected socket
+     * @param ctx TLS context of this side
+     */
+    TlsSocket(Socket &sock, TlsContext &ctx)
+        : _sock{ sock }, _ssl{ SSL_new(ctx.native()) }
+    {
+        if (_ssl == nullptr || SSL_set_fd(_ssl, _sock.fd()) != 1) {
+            _sock.setstate(std::ios::failbit);
+            return;
+        }
+        // a write that would block is retried from another buffer holding the same bytes, see sendfile()
+        SSL_set_mode(_ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    }
+    TlsSocket(const TlsSocket &) = delete;
+    TlsSocket &operator=(const TlsSocket &) = delete;
+    ~TlsSocket()
+    {
+        SSL_free(_ssl);
+    }
+
+    /**
+     * @brief Perform the server side of the handshake
+     */
+    bool accept()
+    {
+        if (_sock.good() && SSL_accept(_ssl) != 1)
+            _sock.setstate(std::ios::failbit);
+        return (_sock.good());
+    }
+    /**
+     * @brief Perform the client side of the handshake
+     * @param hostname server name sent with SNI and matched against its certificate
+     */
+    bool connect(const char *hostname = nullptr)
+    {
+        if (hostname != nullptr) {
+            SSL_set_tlsext_host_name(_ssl, hostname);
+            SSL_set1_host(_ssl, hostname);
+        }
+        if (_sock.good() && SSL_connect(_ssl) != 1)
+            _sock.setstate(std::ios::failbit);
+        return (_sock.good());
+    }
+
+    /**
+     * @brief Read decrypted data
+     * On a non-blocking socket that would block, gcount() is 0.
+     * @param buffer buffer to read data into
+     * @param len maximum number of bytes to read
+     */
+    TlsSocket &read(char *buffer, std::streamsize len)
+    {
+        std::size_t rdsize = 0;
+
+        _count = 0;
+        int ret = SSL_read_ex(_ssl, buffer, len, &rdsize);
+        if (ret == 1)
+            _count = rdsize;
+        else
+            this->error(ret);
+        return (*this);
+    }
+    /**
+     * @brief Write data, encrypted
+     * On a non-blocking socket that would block, gcount() is 0.
+     * @param buffer buffer to write data from
+     * @param len number of bytes to write
+     */
+    TlsSocket &write(const char *buffer, std::streamsize len)
+    {
+        std::size_t wrsize = 0;
+
+        _count = 0;
+        int ret = SSL_write_ex(_ssl, buffer, len, &wrsize);
+        if (ret == 1)
+            _count = wrsize;
+        else
+            this->error(ret);
+        return (*this);
+    }
+    /**
+     * @brief Send part of a file
+     * Uses sendfile(2) when kernel TLS handles transmission, so the data never
+     * reaches user space; reads and encrypts it in user space otherwise.
+     * @param fd file descriptor to send from
+     * @param offset offset of the data in the file
+     * @param size number of bytes to send
+     * Loops until 'size' bytes are sent, the file ends or the socket would
+     * block, in which case fewer bytes are reported: call again from the
+     * offset reached, with no fewer bytes left to send.
+     * @return number of bytes sent, -1 on error
+     */
+    ssize_t sendfile(int fd, off_t offset, std::size_t size)
+    {
+        std::size_t sent = 0;
+        bool failed = false;
+
+        if (this->ktlsSend()) {
+            while (sent < size) {
+                ossl_ssize_t ret = SSL_sendfile(_ssl, fd, offset + sent, size - sent, 0);
+                if (ret <= 0) {
+                    failed = this->error(static_cast<int>(ret));
+                    break;
+                }
+                sent += ret;
+            }
+            return (failed ? -1 : static_cast<ssize_t>(sent));
+        }
+        char buffer[16384];
+        while (sent < size) {
+            ssize_t rdsize = ::pread(fd, buffer, std::min(sizeof(buffer), size - sent), offset + sent);
+            if (rdsize < 0)
+                return (-1);
+            if (rdsize == 0)
+                break;
+            // a write that would block reports nothing sent, but OpenSSL keeps
+            // the record and expects the same bytes again: the next call reads
+            // them back from the file, into a buffer that may have moved, which
+            // SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER allows
+            std::size_t wrsize = 0;
+            int ret = SSL_write_ex(_ssl, buffer, rdsize, &wrsize);
+            if (ret != 1) {
+                failed = this->error(ret);
+                break;
+            }
+            sent += wrsize;
+        }
+        return (failed ? -1 : static_cast<ssize_t>(sent));
+    }
+    /**
+     * @brief Send a close_notify alert
+     */
+    void shutdown()
+    {
+        SSL_shutdown(_ssl);
+    }
+
+    /**
+     * @brief Check whether the kernel encrypts sent records
+     */
+    inline bool ktlsSend() const
+    {
+        return (BIO_get_ktls_send(SSL_get_wbio(_ssl)) != 0);
+    }
+    /**
+     * @brief Check whether the kernel decrypts received records
+     */
+    inline bool ktlsRecv() const
+    {
+        return (BIO_get_ktls_recv(SSL_get_rbio(_ssl)) != 0);
+    }
+    /**
+     * @brief Get the negotiated protocol version and cipher, e.g. "TLSv1.3 TLS_AES_128_GCM_SHA256"
+     */
+    std::string description() const
+    {
+        return (std::string(SSL_get_version(_ssl)) + " " + SSL_get_cipher_name(_ssl));
+    }
+
+    /**
+     * @brief Get number of bytes transferred by the last read or write
+     */
+    inline std::streamsize gcount() const
+    {
+        return (_count);
+    }
+    explicit operator bool() const
+    {
+        return (!_sock.fail());
+    }
+
+private:
+    /**
+     * @brief Update the socket state after a failed OpenSSL I/O call
+     * Without an rdbuf, setting eofbit sets badbit too: callers tell a
+     * clean close_notify from a failure by the result instead.
+     * @param ret value returned by the call
+     * @return true if the connection failed, false if it would block or was closed cleanly
+     */
+    bool error(int ret)
+    {
+        switch (SSL_get_error(_ssl, ret)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            return (false);
+        case SSL_ERROR_ZERO_RETURN:
+            _sock.setstate(std::ios::eofbit);
+            return (false);
+        default:
+            _sock.setstate(std::ios::badbit);
+            return (true);
+        }
+    }
+};
@@ -0,0 +1,512 @@
+/*
+* LibSocket C++ binding
+* Header-only RFC 6455 WebSocket handshake and framing
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/uio.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Http.hpp"
+#include "Socket.hpp"
+
+/**
+ * @brief WebSocket endpoint over a blocking Socket
+ * Received frames are unmasked in place in the socket's receive buffer and
+ * unfragmented messages are returned without copy. Frames are sent with a
+ * single writev(2) of header and payload.
+ */
+class WebSocket
+{
+public:
+    /**
+     * @brief Frame opcodes
+     */
+    enum Opcode : uint8_t {
+        Continuation = 0x0,
+        Text = 0x1,
+        Binary = 0x2,
+        Close = 0x8,
+        Ping = 0x9,
+        Pong = 0xA
+    };
+
+    /**
+     * @brief Maximum size of a frame or reassembled message
+     */
+    static constexpr std::size_t MAX_MESSAGE_SIZE = 64 << 20;
+
+private:
+    Socket &_sock;
+    bool _client;
+    bool _open{ false };
+    bool _closeSent{ false };
+    uint16_t _closeCode{ 0 };
+    std::size_t _consumed{ 0 };
+    Opcode _messageOp{ Continuation };
+    std::string _message;
+    std::string _scratch;
+    std::mt19937 _rng{ std::random_device{}() };
+
+public:
+    /**
+     * @brief Construct a WebSocket endpoint over a connected socket
+     * @param sock connected socket
+     * @param client true on the connecting side, which masks its frames
+     */
+    WebSocket(Socket &sock, bool client)
+        : _sock{ sock }, _client{ client }
+    {
+    }
+
+    /**
+     * @brief Perform the server side of the opening handshake
+     */
+    bool accept()
+    {
+        HttpParser parser;
+        HttpRequest req;
+        std::size_t consumed = 0;
+
+        while (true) {
+            HttpParser::Status status = parser.parse(_sock.bufferedData(), _sock.bufferedSize(), req, consumed);
+            if (status == HttpParser::Complete)
+                break;
+            if (status == HttpParser::Invalid || _sock.fill() <= 0)
+                return (false);
+        }
+        std::string_view key = req.header("Sec-WebSocket-Key");
+        bool valid = HttpRequest::iequals(req.header("Upgrade"), "websocket")
+            && hasToken(req.header("Connection"), "Upgrade") && req.header("Sec-WebSocket-Version") == "13"
+            && !key.empty();
+        std::string out;
+        HttpResponse res(out, valid);
+        if (valid) {
+            std::string accept = acceptKey(key);
+            res.status(101, "Switching Protocols").header("Upgrade", "websocket").header("Connection", "Upgrade");
+            res.header("Sec-WebSocket-Accept", accept);
+            out.append("\r\n");
+        } else {
+            res.status(400, "Bad Request").finish();
+        }
+        _sock.consume(consumed);
+        // the 400 reply goes out too, so that the client learns why it was refused
+        bool written = this->writeAll(out.data(), out.size());
+        _open = valid && written;
+        return (_open);
+    }
+
+    /**
+     * @brief Perform the client side of the opening handshake
+     * @param host value of the Host header
+     * @param path request target
+     */
+    bool handshake(std::string_view host, std::string_view path = "/")
+    {
+        unsigned char nonce[16];
+        for (std::size_t i = 0; i < sizeof(nonce); i += 4) {
+            uint32_t r = _rng();
+            std::memcpy(nonce + i, &r, 4);
+        }
+        std::string key = base64(nonce, sizeof(nonce));
+        std::string out;
+        out.append("GET ").append(path).append(" HTTP/1.1\r\nHost: ").append(host);
+        out.append("\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: ");
+        out.append(key).append("\r\n\r\n");
+        if (!this->writeAll(out.data(), out.size()))
+            return (false);
+
+        std::size_t end = std::string_view::npos;
+        while ((end = _sock.buffered().find("\r\n\r\n")) == std::string_view::npos)
+            if (_sock.bufferedSize() > HttpParser::MAX_HEADER_SIZE || _sock.fill() <= 0)
+                return (false);
+        std::string_view head = _sock.buffered().substr(0, end + 2);
+        _open = head.compare(0, 13, "HTTP/1.1 101 ") == 0 && HttpRequest::iequals(headerOf(head, "Upgrade"), "websocket")
+            && hasToken(headerOf(head, "Connection"), "Upgrade") && headerOf(head, "Sec-WebSocket-Accept") == acceptKey(key);
+        _sock.consume(end + 4);
+        return (_open);
+    }
+
+    /**
+     * @brief Send a message in a single frame
+     * @param data message payload
+     * @param op Text or Binary
+     */
+    bool send(std::string_view data, Opcode op = Binary)
+    {
+        return (_open && !_closeSent && this->sendFrame(op, data));
+    }
+    /**
+     * @brief Send a ping
+     * @param data ping payload, at most 125 bytes
+     */
+    bool ping(std::string_view data = std::string_view())
+    {
+        return (_open && !_closeSent && data.size() <= 125 && this->sendFrame(Ping, data));
+    }
+    /**
+     * @brief Start the closing handshake
+     * @param code close status code
+     * @param reason close reason, at most 123 bytes
+     */
+    bool close(uint16_t code = 1000, std::string_view reason = std::string_view())
+    {
+        char payload[125];
+
+        if (!_open || _closeSent || reason.size() > 123)
+            return (false);
+        payload[0] = static_cast<char>(code >> 8);
+        payload[1] = static_cast<char>(code & 0xFF);
+        std::memcpy(payload + 2, reason.data(), reason.size());
+        _closeSent = true;
+        return (this->sendFrame(Close, std::string_view(payload, reason.size() + 2)));
+    }
+
+    /**
+     * @brief Receive the next data message, answering control frames meanwhile
+     * The returned view stays valid until the next call.
+     * @param message set to the message payload
+     * @param op set to the message opcode, Text or Binary
+     * @return false once the connection is closed or failed
+     */
+    bool receive(std::string_view &message, Opcode &op)
+    {
+        while (_open) {
+            _sock.consume(_consumed);
+            _consumed = 0;
+            uint8_t opcode = 0;
+            bool fin = false;
+            std::string_view payload;
+            if (!this->readFrame(opcode, fin, payload))
+                return (this->fail(1002));
+            if (opcode >= Close) {
+                if (!fin || payload.size() > 125)
+                    return (this->fail(1002));
+                if (!this->control(static_cast<Opcode>(opcode), payload))
+                    return (false);
+                continue;
+            }
+            if ((opcode == Continuation) == (_messageOp == Continuation))
+                return (this->fail(1002));
+            if (opcode != Continuation && fin) {
+                op = static_cast<Opcode>(opcode);
+                message = payload;
+                return (true);
+            }
+            if (opcode != Continuation) {
+                _messageOp = static_cast<Opcode>(opcode);
+                _message.clear();
+            }
+            if (_message.size() + payload.size() > MAX_MESSAGE_SIZE)
+                return (this->fail(1009));
+            _message.append(payload);
+            if (fin) {
+                op = _messageOp;
+                _messageOp = Continuation;
+                message = _message;
+                return (true);
+            }
+        }
+        return (false);
+    }
+
+    /**
+     * @brief Check whether the connection is open
+     */
+    inline bool isOpen() const
+    {
+        return (_open);
+    }
+    /**
+     * @brief Get the status code of the received close frame, 0 if none
+     */
+    inline uint16_t closeCode() const
+    {
+        return (_closeCode);
+    }
+
+    /**
+     * @brief XOR data with a 4-byte masking key
+     * Processes 16 bytes at a time when SSE2 is available, 8 bytes otherwise.
+     * @param dst destination buffer, may be equal to src
+     * @param src source buffer
+     * @param len number of bytes to mask
+     * @param key masking key, in the byte order it appears on the wire
+     */
+    static void mask(char *dst, const char *src, std::size_t len, const unsigned char key[4])
+    {
+        uint32_t key32 = 0;
+        std::memcpy(&key32, key, 4);
+        uint64_t key64 = (static_cast<uint64_t>(key32) << 32) | key32;
+        std::size_t i = 0;
+#if defined(__SSE2__)
+        const __m128i vkey = _mm_set1_epi32(static_cast<int>(key32));
+        for (; i + 16 <= len; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_xor_si128(v, vkey));
+        }
+#endif
+        for (; i + 8 <= len; i += 8) {
+            uint64_t v;
+            std::memcpy(&v, src + i, 8);
+            v ^= key64;
+            std::memcpy(dst + i, &v, 8);
+        }
+        for (; i < len; ++i)
+            dst[i] = src[i] ^ key[i & 3];
+    }
+
+private:
+    bool fail(uint16_t code)
+    {
+        this->close(code);
+        _open = false;
+        return (false);
+    }
+
+    /**
+     * @brief Handle a control frame
+     * @return false once the connection is closed
+     */
+    bool control(Opcode opcode, std::string_view payload)
+    {
+        if (opcode == Ping)
+            return (this->sendFrame(Pong, payload) || this->fail(1011));
+        if (opcode == Pong)
+            return (true);
+        _closeCode = (payload.size() >= 2) ? (static_cast<uint8_t>(payload[0]) << 8 | static_cast<uint8_t>(payload[1])) : 1005;
+        if (!_closeSent)
+            this->close(payload.size() >= 2 ? _closeCode : 1000);
+        _open = false;
+        return (false);
+    }
+
+    /**
+     * @brief Read a whole frame into the receive buffer and unmask it in place
+     */
+    bool readFrame(uint8_t &opcode, bool &fin, std::string_view &payload)
+    {
+        std::size_t header = 2;
+        uint64_t len = 0;
+
+        while (true) {
+            std::size_t avail = _sock.bufferedSize();
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(_sock.bufferedData());
+            if (avail >= 2) {
+                len = p[1] & 0x7F;
+                header = 2 + (len == 126 ? 2 : len == 127 ? 8 : 0) + ((p[1] & 0x80) ? 4 : 0);
+            }
+            if (avail >= header) {
+                if ((p[0] & 0x70) != 0 || ((p[1] & 0x80) != 0) == _client)
+                    return (false);
+                if (len >= 126) {
+                    std::size_t bytes = (len == 126) ? 2 : 8;
+                    len = 0;
+                    for (std::size_t i = 0; i < bytes; ++i)
+                        len = (len << 8) | p[2 + i];
+                }
+                if (len > MAX_MESSAGE_SIZE)
+                    return (false);
+                if (avail >= header + len)
+                    break;
+            }
+            if (_sock.fill() <= 0)
+                return (false);
+        }
+        char *data = _sock.bufferedData();
+        const unsigned char *key = reinterpret_cast<unsigned char *>(data + header - 4);
+        fin = (data[0] & 0x80) != 0;
+        opcode = data[0] & 0x0F;
+        if (!_client)
+            mask(data + header, data + header, len, key);
+        payload = std::string_view(data + header, len);
+        _consumed = header + len;
+        return (opcode <= Binary || (opcode >= Close && opcode <= Pong));
+    }
+
+    /**
+     * @brief Send a single final frame, masking a copy of the payload on the client side
+     */
+    bool sendFrame(Opcode opcode, std::string_view payload)
+    {
+        unsigned char header[14];
+        std::size_t hlen = 2;
+
+        header[0] = 0x80 | opcode;
+        if (payload.size() < 126) {
+            header[1] = payload.size();
+        } else if (payload.size() <= 0xFFFF) {
+            header[1] = 126;
+            header[2] = payload.size() >> 8;
+            header[3] = payload.size() & 0xFF;
+            hlen = 4;
+        } else {
+            header[1] = 127;
+            for (int i = 0; i < 8; ++i)
+                header[2 + i] = static_cast<uint64_t>(payload.size()) >> (56 - 8 * i);
+            hlen = 10;
+        }
+        if (_client) {
+            uint32_t r = _rng();
+            header[1] |= 0x80;
+            std::memcpy(header + hlen, &r, 4);
+            _scratch.resize(payload.size());
+            mask(&_scratch[0], payload.data(), payload.size(), header + hlen);
+            payload = _scratch;
+            hlen += 4;
+        }
+        struct iovec iov[2] = {
+            { header, hlen },
+            { const_cast<char *>(payload.data()), payload.size() }
+        };
+        return (this->writeAll(iov, payload.empty() ? 1 : 2));
+    }
+
+    bool writeAll(const char *data, std::size_t len)
+    {
+        struct iovec iov = { const_cast<char *>(data), len };
+        return (this->writeAll(&iov, 1));
+    }
+    bool writeAll(struct iovec *iov, int count)
+    {
+        while (count > 0 && _sock.writev(iov, count)) {
+            std::size_t written = _sock.gcount();
+            while (count > 0 && written >= iov->iov_len) {
+                written -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (count > 0) {
+                iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            }
+        }
+        return (count == 0);
+    }
+
+    /**
+     * @brief Find a header value in a raw response head, by case-insensitive name
+     * @param head status line and header lines, each ending with CRLF
+     * @return value without surrounding whitespace, or an empty view if missing
+     */
+    static std::string_view headerOf(std::string_view head, std::string_view name)
+    {
+        std::size_t pos = head.find("\r\n");
+        while (pos != std::string_view::npos && pos + 2 < head.size()) {
+            std::size_t begin = pos + 2;
+            pos = head.find("\r\n", begin);
+            std::string_view line = head.substr(begin, pos - begin);
+            std::size_t colon = line.find(':');
+            if (colon != std::string_view::npos && HttpRequest::iequals(line.substr(0, colon), name))
+                return (trim(line.substr(colon + 1)));
+        }
+        return (std::string_view());
+    }
+    /**
+     * @brief Check whether a comma-separated header value holds a token, case-insensitively
+     */
+    static bool hasToken(std::string_view list, std::string_view token)
+    {
+        while (!list.empty()) {
+            std::size_t comma = list.find(',');
+            if (HttpRequest::iequals(trim(list.substr(0, comma)), token))
+                return (true);
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        }
+        return (false);
+    }
+    static std::string_view trim(std::string_view s)
+    {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+        return (s);
+    }
+
+    /**
+     * @brief Compute Sec-WebSocket-Accept for a Sec-WebSocket-Key
+     */
+    static std::string acceptKey(std::string_view key)
+    {
+        std::string input(key);
+        unsigned char digest[20];
+
+        input.append("258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+        sha1(reinterpret_cast<const unsigned char *>(input.data()), input.size(), digest);
+        return (base64(digest, sizeof(digest)));
+    }
+
+    static std::string base64(const unsigned char *data, std::size_t len)
+    {
+        static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+
+        for (std::size_t i = 0; i < len; i += 3) {
+            uint32_t n = data[i] << 16;
+            if (i + 1 < len)
+                n |= data[i + 1] << 8;
+            if (i + 2 < len)
+                n |= data[i + 2];
+            out.push_back(table[(n >> 18) & 63]);
+            out.push_back(table[(n >> 12) & 63]);
+            out.push_back(i + 1 < len ? table[(n >> 6) & 63] : '=');
+            out.push_back(i + 2 < len ? table[n & 63] : '=');
+        }
+        return (out);
+    }
+
+    static void sha1(const unsigned char *data, std::size_t len, unsigned char digest[20])
+    {
+        uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+        std::string msg(reinterpret_cast<const char *>(data), len);
+        uint64_t bits = static_cast<uint64_t>(len) * 8;
+
+        msg.push_back(static_cast<char>(0x80));
+        while (msg.size() % 64 != 56)
+            msg.push_back('\0');
+        for (int i = 7; i >= 0; --i)
+            msg.push_back(static_cast<char>(bits >> (i * 8)));
+        for (std::size_t off = 0; off < msg.size(); off += 64) {
+            uint32_t w[80];
+            const unsigned char *b = reinterpret_cast<const unsigned char *>(msg.data() + off);
+            for (int i = 0; i < 16; ++i)
+                w[i] = b[4 * i] << 24 | b[4 * i + 1] << 16 | b[4 * i + 2] << 8 | b[4 * i + 3];
+            for (int i = 16; i < 80; ++i)
+                w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            uint32_t a = h[0], bb = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i) {
+                uint32_t f = (i < 20) ? ((bb & c) | (~bb & d)) + 0x5A827999
+                    : (i < 40) ? (bb ^ c ^ d) + 0x6ED9EBA1
+                    : (i < 60) ? ((bb & c) | (bb & d) | (c & d)) + 0x8F1BBCDC
+                    : (bb ^ c ^ d) + 0xCA62C1D6;
+                uint32_t t = rotl(a, 5) + f + e + w[i];
+                e = d;
+                d = c;
+                c = rotl(bb, 30);
+                bb = a;
+                a = t;
+            }
+            h[0] += a;
+            h[1] += bb;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        }
+        for (int i = 0; i < 20; ++i)
+            digest[i] = h[i / 4] >> (24 - 8 * (i % 4));
+    }
+
+    static inline uint32_t rotl(uint32_t x, int n)
+    {
+        return ((x << n) | (x >> (32 - n)));
+    }
+};
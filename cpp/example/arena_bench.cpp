@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../BufferArena.hpp"
+
+// CONNECTIONS receive buffers of 16 KB, each next to some per-connection
+// state, touched in random order as an event loop serving many connections
+// would. Compares std::allocator with BufferArena, reporting data TLB misses
+// from perf counters where the kernel and hardware expose them, and the
+// transparent huge pages backing the process.
+
+static const std::size_t CONNECTIONS = 16384;
+static const std::size_t BUFFER = 16 << 10;
+static const int ROUNDS = 20;
+
+/**
+ * @brief Data TLB load miss counter of this thread, user space only
+ */
+class TlbMisses
+{
+private:
+    int _fd{ -1 };
+
+public:
+    TlbMisses()
+    {
+        struct perf_event_attr attr = {};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        _fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~TlbMisses()
+    {
+        if (_fd != -1)
+            close(_fd);
+    }
+    bool available() const
+    {
+        return (_fd != -1);
+    }
+    void start()
+    {
+        ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    uint64_t stop()
+    {
+        uint64_t count = 0;
+        ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(_fd, &count, sizeof(count)) != sizeof(count))
+            return (0);
+        return (count);
+    }
+};
+
+static long anonHugeKb()
+{
+    std::ifstream smaps("/proc/self/smaps_rollup");
+    std::string key;
+    long value = 0;
+    while (smaps >> key) {
+        if (key == "AnonHugePages:") {
+            smaps >> value;
+            return (value);
+        }
+    }
+    return (-1);
+}
+
+template <typename Allocator>
+static void run(const char *mode)
+{
+    std::vector<std::vector<char, Allocator>> buffers(CONNECTIONS);
+    std::vector<std::string> state(CONNECTIONS);
+    for (std::size_t i = 0; i < CONNECTIONS; ++i) {
+        // interleave with other allocations as accepting connections does
+        state[i].assign(300, 's');
+        buffers[i].resize(BUFFER);
+    }
+    std::vector<uint32_t> order(CONNECTIONS * ROUNDS);
+    std::mt19937 rng(1);
+    for (uint32_t &i : order)
+        i = rng() % CONNECTIONS;
+
+    TlbMisses misses;
+    uint64_t sum = 0;
+    if (misses.available())
+        misses.start();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i : order) {
+        char *buf = buffers[i].data() + (i * 977) % (BUFFER - 256);
+        std::memset(buf, static_cast<char>(i), 64);
+        for (int k = 0; k < 256; k += 64)
+            sum += static_cast<unsigned char>(buf[k]);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << mode << ": " << elapsed.count() / order.size() << " ns per access, ";
+    if (misses.available())
+        std::cout << double(misses.stop()) / order.size() << " dTLB misses per access, ";
+    else
+        std::cout << "dTLB counter unavailable, ";
+    std::cout << anonHugeKb() / 1024 << " MB in transparent huge pages (" << sum % 2 << ")" << std::endl;
+}
+
+int main(void)
+{
+    run<std::allocator<char>>("std::allocator");
+    run<ArenaAllocator<char>>("BufferArena   ");
+
+    BufferArena::Stats stats = BufferArena::local().stats();
+    std::cout << "arena slabs: " << stats.slabs[BufferArena::HugeTlb] << " hugetlb, "
+              << stats.slabs[BufferArena::Transparent] << " transparent, " << stats.slabs[BufferArena::SmallPages]
+              << " small pages; " << stats.inUse << " buffers in use" << std::endl;
+    std::size_t released = BufferArena::local().trim();
+    std::cout << "trim after the connections closed: " << released << " slabs released" << std::endl;
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Broadcast.hpp"
+
+static const int SUBSCRIBERS = 64;
+static const int SYMBOLS = 16;
+static const long MESSAGES = 1000000;
+static const int BATCH = 64;
+
+int main(void)
+{
+    EventLoop loop;
+    Broadcaster broadcaster(loop, Broadcaster::Conflate, 64 << 10);
+    broadcaster.listen(Endpoint::any(1224));
+
+    // one reader thread drains every subscriber but the last, which never reads
+    std::vector<Socket> subs(SUBSCRIBERS);
+    for (Socket &sub : subs)
+        sub.connect(Endpoint::loopback(1224));
+    while (broadcaster.subscribers() < SUBSCRIBERS)
+        loop.runOnce(10);
+
+    // an empty message has nothing to deliver and must not cost anyone their connection
+    broadcaster.publish(std::string_view());
+    broadcaster.flush();
+    loop.runOnce(10);
+    if (broadcaster.subscribers() != SUBSCRIBERS) {
+        std::cerr << "empty message dropped " << SUBSCRIBERS - broadcaster.subscribers() << " subscribers" << std::endl;
+        return 1;
+    }
+
+    std::atomic<bool> done{ false };
+    std::atomic<long> received{ 0 };
+    std::thread reader([&]() {
+        EventLoop readLoop;
+        for (int i = 0; i < SUBSCRIBERS - 1; ++i) {
+            Socket &sub = subs[i];
+            sub.setBlocking(false);
+            readLoop.add(sub.fd(), EPOLLIN, [&](uint32_t) {
+                while (sub.fill() > 0) {
+                    received += sub.bufferedSize();
+                    sub.consume(sub.bufferedSize());
+                }
+            });
+        }
+        while (!done)
+            readLoop.runOnce(10);
+    });
+
+    std::string message(100, 'x');
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < MESSAGES; ++i) {
+        message.replace(0, 8, std::to_string(10000000 + i % SYMBOLS));
+        broadcaster.publish(Broadcaster::encode(message), 1 + i % SYMBOLS);
+        if (i % BATCH == BATCH - 1) {
+            broadcaster.flush();
+            loop.runOnce(0);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    while (loop.runOnce(100) > 0)
+        ;
+    done = true;
+    reader.join();
+
+    std::cout << SUBSCRIBERS << " subscribers: " << MESSAGES / elapsed.count() << " msg/s published, "
+              << received / message.size() << " of " << MESSAGES * (SUBSCRIBERS - 1) << " delivered to readers, "
+              << broadcaster.dropped() << " dropped or conflated" << std::endl;
+    return 0;
+}
@@ -7,7 +7,7 @@ int main(void)
     std::string buffer;
     Socket client;
 
-    client.connect(htons(1212), INADDR_ANY);
+    client.connect(Endpoint::loopback(1212));
     client.getline(buffer);
     std::cout << buffer << std::endl;
     return 0;
@@ -0,0 +1,77 @@
+/*
+* Build: g++ -std=c++17 -O2 compress_bench.cpp -o compress_bench -pthread -llz4 -lzstd
+* Without the lz4 and zstd headers, drop the libraries: only the None codec is then available.
+*/
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../Compression.hpp"
+
+static const std::size_t TOTAL = 256 << 20;
+static const char *NAMES[] = { "none", "lz4", "zstd" };
+
+/**
+ * @brief Generate log-like text: repetitive structure, varying fields
+ */
+static std::string syntheticLogs(std::size_t size)
+{
+    static const char *levels[] = { "INFO", "WARN", "DEBUG", "ERROR" };
+    std::string logs;
+
+    for (unsigned i = 0; logs.size() < size; ++i) {
+        logs += "2026-10-17T12:";
+        logs += std::to_string(10 + i % 50) + ":" + std::to_string(10 + i % 49);
+        logs += " [" + std::string(levels[i % 4]) + "] replication: shipped segment ";
+        logs += std::to_string(i * 7919 % 100000) + " to replica-" + std::to_string(i % 12);
+        logs += " (" + std::to_string(i % 4096) + " bytes)\n";
+    }
+    logs.resize(size);
+    return (logs);
+}
+
+int main(void)
+{
+    std::string logs = syntheticLogs(1 << 20);
+    Socket server;
+    server.listen(Endpoint::any(1221));
+    bool intact = true;
+
+    for (bool preferRatio : { false, true }) {
+        std::size_t received = 0, mismatches = 0;
+        std::thread receiver([&]() {
+            Socket client = server.accept();
+            CompressedSocket stream(client);
+            char buffer[65536];
+            stream.negotiate(preferRatio);
+            // the sender repeats the same text: check every byte against it
+            while (stream.read(buffer, sizeof(buffer))) {
+                for (std::streamsize i = 0; i < stream.gcount(); ++i)
+                    mismatches += buffer[i] != logs[(received + i) % logs.size()];
+                received += stream.gcount();
+            }
+        });
+        Socket sock;
+        sock.connect(Endpoint::loopback(1221));
+        std::clock_t cpu = std::clock();
+        auto start = std::chrono::steady_clock::now();
+        {
+            CompressedSocket stream(sock);
+            std::cout << NAMES[static_cast<int>(stream.negotiate(preferRatio))] << ": ";
+            for (std::size_t sent = 0; sent < TOTAL; sent += logs.size())
+                stream.write(logs.data(), logs.size());
+        }
+        sock.close();
+        receiver.join();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double seconds = static_cast<double>(std::clock() - cpu) / CLOCKS_PER_SEC;
+        bool ok = received == TOTAL && mismatches == 0;
+        intact = intact && ok;
+        std::cout << TOTAL / elapsed.count() / 1e6 << " MB/s effective, "
+                  << seconds / elapsed.count() * 100 << "% CPU (both ends), round trip "
+                  << (ok ? "intact" : "CORRUPTED") << std::endl;
+    }
+    return (!intact);
+}
@@ -0,0 +1,66 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <x86intrin.h>
+
+#include "../Frame.hpp"
+
+static const std::size_t SIZE = 64 << 10;
+static const int ROUNDS = 20000;
+
+/**
+ * @brief Previous approach: one table lookup per byte
+ */
+static uint32_t bytewise(const unsigned char *p, std::size_t len)
+{
+    static uint32_t table[256];
+    uint32_t crc = ~0u;
+
+    if (table[1] == 0)
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+            table[n] = c;
+        }
+    while (len--)
+        crc = (crc >> 8) ^ table[(crc ^ *p++) & 0xFF];
+    return (~crc);
+}
+
+int main(void)
+{
+    std::string data(SIZE, '\0');
+    for (std::size_t i = 0; i < SIZE; ++i)
+        data[i] = static_cast<char>(i * 2654435761u >> 24);
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data.data());
+    uint32_t sink = 0;
+
+    uint64_t start = __rdtsc();
+    for (int i = 0; i < ROUNDS / 10; ++i)
+        sink ^= bytewise(p, SIZE);
+    std::cout << "byte-wise table: " << double(__rdtsc() - start) / (ROUNDS / 10 * SIZE) << " cycles/byte" << std::endl;
+    start = __rdtsc();
+    for (int i = 0; i < ROUNDS; ++i)
+        sink ^= Crc32c::compute(p, SIZE);
+    std::cout << "Crc32c (" << (Crc32c::hardware() ? "sse4.2" : "tables") << "): "
+              << double(__rdtsc() - start) / (ROUNDS * SIZE) << " cycles/byte" << std::endl;
+
+    std::string frames;
+    std::size_t offset = Frame::begin(frames);
+    frames += data;
+    Frame::end(frames, offset, true);
+    FrameReader reader(true);
+    std::string_view payload;
+    std::size_t consumed = 0;
+    start = __rdtsc();
+    for (int i = 0; i < ROUNDS; ++i) {
+        Frame::Status status = Frame::Incomplete;
+        for (std::size_t len = 1460; status == Frame::Incomplete; len += 1460)
+            status = reader.parse(frames.data(), std::min(len, frames.size()), payload, consumed);
+        sink += (status == Frame::Complete);
+    }
+    std::cout << "FrameReader, verified per 1460-byte segment: "
+              << double(__rdtsc() - start) / (ROUNDS * SIZE) << " cycles/byte" << std::endl;
+    return (sink == 42);
+}
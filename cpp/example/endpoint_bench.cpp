@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include "../Endpoint.hpp"
+
+// validated at compile time: an invalid literal here fails to build
+static constexpr ParsedEndpoint LISTEN = ":8080"_endpoint;
+static constexpr ParsedEndpoint UPSTREAM = "[2001:db8::1]:443"_endpoint;
+static_assert(LISTEN.kind == ParsedEndpoint::Ipv4 && LISTEN.port == 8080);
+static_assert(UPSTREAM.kind == ParsedEndpoint::Ipv6 && UPSTREAM.addr[0] == 0x20 && UPSTREAM.addr[15] == 1);
+static_assert(!ParsedEndpoint::parse("10.0.0.256:80").ok());
+
+static const int ROUNDS = 200000;
+
+int main(void)
+{
+    const char *samples[] = {
+        "127.0.0.1:80", "10.0.0.1", "[::1]:8080", "fe80::1%2", "[::ffff:192.0.2.1]:443",
+        "db-01.example.com:5432", "localhost", ":9000", "/run/app.sock", "unix:./app.sock",
+        "1.2.3", "01.2.3.4", "256.1.1.1:80", "[::1", "[::1]x", "1::2::3", "1:2:3:4:5:6:7:8:9",
+        "host:", "host:http", "host:65536", "-bad.example", "a..b", "[fe80::1%eth0]:80", ""
+    };
+    for (const char *text : samples) {
+        ParsedEndpoint ep = ParsedEndpoint::parse(text);
+        std::cout << '"' << text << "\": ";
+        if (!ep.ok()) {
+            std::cout << ParsedEndpoint::strerror(ep.error) << " at offset " << ep.where << std::endl;
+            continue;
+        }
+        char buf[INET6_ADDRSTRLEN] = "";
+        if (ep.kind == ParsedEndpoint::Ipv4)
+            inet_ntop(AF_INET, ep.addr, buf, sizeof(buf));
+        else if (ep.kind == ParsedEndpoint::Ipv6)
+            inet_ntop(AF_INET6, ep.addr, buf, sizeof(buf));
+        else
+            std::string(ep.host).copy(buf, sizeof(buf) - 1);
+        const char *kinds[] = { "ipv4", "ipv6", "host", "unix" };
+        std::cout << kinds[ep.kind] << ' ' << buf << " port " << ep.port << std::endl;
+    }
+
+    // cross-check numeric addresses against inet_pton
+    srand(1);
+    std::vector<std::string> inputs;
+    for (int i = 0; i < 100000; ++i) {
+        std::string s;
+        const char alphabet[] = "0123456789abcdef:.";
+        int len = 2 + rand() % 20;
+        for (int k = 0; k < len; ++k)
+            s += alphabet[rand() % (sizeof(alphabet) - 1)];
+        inputs.push_back(s);
+    }
+    int mismatches = 0;
+    for (const std::string &s : inputs) {
+        unsigned char expected[16] = {};
+        bool v4 = s.find(':') == std::string::npos;
+        bool valid = inet_pton(v4 ? AF_INET : AF_INET6, s.c_str(), expected) == 1;
+        ParsedEndpoint ep = v4 && valid ? ParsedEndpoint::parse(s) : ParsedEndpoint::parse("[" + s + "]");
+        if (v4 && !valid)
+            continue; // "1.2.3" and the like are host names or errors depending on context
+        bool same = ep.ok() == valid && (!valid || std::memcmp(ep.addr, expected, v4 ? 4 : 16) == 0);
+        if (!same && ++mismatches < 5)
+            std::cout << "mismatch: " << s << " inet_pton=" << valid << " parse=" << ep.ok() << std::endl;
+    }
+    std::cout << inputs.size() << " random addresses checked against inet_pton, " << mismatches << " mismatches" << std::endl;
+
+    std::vector<std::string> endpoints;
+    for (int i = 0; i < 1000; ++i) {
+        endpoints.push_back("10.1." + std::to_string(i / 256) + '.' + std::to_string(i % 256) + ':' + std::to_string(1024 + i));
+        endpoints.push_back("[2001:db8::" + std::to_string(i) + "]:" + std::to_string(1024 + i));
+        endpoints.push_back("node-" + std::to_string(i) + ".cluster.local:" + std::to_string(1024 + i));
+    }
+    unsigned sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS / 1000; ++r)
+        for (const std::string &text : endpoints)
+            sink += ParsedEndpoint::parse(text).port;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "ParsedEndpoint::parse: " << endpoints.size() * (ROUNDS / 1000) / elapsed.count() / 1e6 << " M endpoints/s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS / 1000 / 10; ++r)
+        for (const std::string &text : endpoints) {
+            struct addrinfo hints = {};
+            struct addrinfo *res = nullptr;
+            std::size_t colon = text.rfind(':');
+            std::string host = text.substr(0, colon);
+            if (host[0] == '[')
+                host = host.substr(1, host.size() - 2);
+            hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+            if (getaddrinfo(host.c_str(), text.c_str() + colon + 1, &hints, &res) == 0) {
+                sink += res->ai_family;
+                freeaddrinfo(res);
+            }
+        }
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "getaddrinfo(AI_NUMERICHOST): " << endpoints.size() * (ROUNDS / 1000 / 10) / elapsed.count() / 1e6
+              << " M endpoints/s (" << sink % 2 << ")" << std::endl;
+    return 0;
+}
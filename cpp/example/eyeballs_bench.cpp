@@ -0,0 +1,55 @@
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <sys/time.h>
+
+#include "../HappyEyeballs.hpp"
+
+// [::1] listens but never accepts: once its queue is full, SYNs are dropped
+// and connects hang as towards an unreachable host. 127.0.0.1 answers.
+int main(void)
+{
+    Endpoint v6 = Endpoint::loopback(1225, AF_INET6);
+    Endpoint v4 = Endpoint::loopback(1225);
+    Socket stalled;
+    stalled.listen(v6, 0);
+    std::vector<Socket> filler;
+    for (int i = 0; i < 2; ++i) {
+        Socket &sock = filler.emplace_back(AF_INET6, SOCK_STREAM);
+        sock.setBlocking(false);
+        sock.connect(v6);
+    }
+    Socket listener;
+    listener.listen(v4);
+    if (!stalled || !listener) {
+        std::cerr << "listen: " << stalled.strerror() << " / " << listener.strerror() << std::endl;
+        return 1;
+    }
+
+    HappyEyeballs::Addresses addrs(2);
+    std::memcpy(&addrs[0], v6.addr(), v6.length());
+    std::memcpy(&addrs[1], v4.addr(), v4.length());
+
+    // sequential: the first address holds us until the connect timeout
+    auto start = std::chrono::steady_clock::now();
+    {
+        Socket sock(AF_INET6, SOCK_STREAM);
+        struct timeval timeout = { 2, 0 };
+        setsockopt(sock.fd(), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        sock.connect(v6);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "sequential, [::1] first: " << (sock ? "connected" : sock.strerror())
+                  << " after " << elapsed.count() * 1e3 << " ms" << std::endl;
+    }
+
+    for (int delay : { 250, 50 }) {
+        start = std::chrono::steady_clock::now();
+        Socket sock = HappyEyeballs::connect(addrs, 1225, std::chrono::milliseconds(delay));
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::string peer = sock.peerEndpoint().toString();
+        std::cout << "happy eyeballs, " << delay << " ms delay: " << (sock.isOpen() ? "connected to " : "failed ")
+                  << peer << " after " << elapsed.count() * 1e3 << " ms" << std::endl;
+        Socket accepted = listener.accept();
+    }
+    return 0;
+}
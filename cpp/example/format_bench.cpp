@@ -0,0 +1,65 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "../Socket.hpp"
+
+static const int LINES = 2000000;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+/**
+ * @brief Emit metrics in line protocol through an std::ostringstream, one write per line
+ */
+static void withStringstream(Socket &sock)
+{
+    std::ostringstream line;
+
+    for (int i = 0; i < LINES; ++i) {
+        line.str("");
+        line << "cpu,host=server" << i % 64 << " usage=" << i * 0.37 << ",count=" << i << "i "
+             << 1434055562000000000LL + i << '\n';
+        std::string str = line.str();
+        sock.write(str.data(), str.size());
+    }
+}
+
+/**
+ * @brief Emit the same metrics formatted straight into the send buffer
+ */
+static void withSocket(Socket &sock)
+{
+    for (int i = 0; i < LINES; ++i)
+        sock << "cpu,host=server" << i % 64 << " usage=" << i * 0.37 << ",count=" << i << "i "
+             << 1434055562000000000LL + i << '\n';
+    sock.flush();
+}
+
+int main(void)
+{
+    Socket server;
+    server.listen(Endpoint::any(1220));
+    std::thread sink([&server]() {
+        char buffer[65536];
+        for (int i = 0; i < 2; ++i) {
+            Socket client = server.accept();
+            while (client.read(buffer, sizeof(buffer)))
+                ;
+        }
+    });
+
+    for (auto bench : { withStringstream, withSocket }) {
+        Socket sock;
+        sock.connect(Endpoint::loopback(1220));
+        auto start = std::chrono::steady_clock::now();
+        bench(sock);
+        std::cout << (bench == withSocket ? "Socket operator<<:        " : "ostringstream + write:    ")
+                  << LINES / elapsed(start) << " lines/s" << std::endl;
+    }
+    sink.join();
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+
+#include "../IoEngine.hpp"
+#include "../Socket.hpp"
+
+// Small-message ping-pong over loopback through io_uring, with plain
+// descriptors and buffers, then hot ones: registered descriptors, then
+// registered descriptors and buffers. PAIRS connections exchange messages in
+// lockstep so that each system call carries many operations and the per
+// operation cost is not drowned by the system call. Modes are interleaved
+// over several passes and the best CPU time per operation of each is reported.
+
+static const int PAIRS = 32;
+static const int ROUNDS = 5000;
+static const std::size_t MESSAGE = 64;
+static const std::size_t SLOT = 4096;
+static const int PASSES = 5;
+
+static double cpuSeconds()
+{
+    struct rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6);
+}
+
+static bool collect(UringEngine &engine, int count)
+{
+    IoCompletion batch[2 * PAIRS];
+
+    while (count > 0) {
+        int n = engine.wait(batch, 2 * PAIRS, 2000);
+        if (n <= 0)
+            return (false);
+        for (int i = 0; i < n; ++i)
+            if (batch[i].result != static_cast<int>(MESSAGE))
+                return (false);
+        count -= n;
+    }
+    return (true);
+}
+
+/**
+ * @return CPU seconds per operation, 0 on failure
+ */
+static double run(const char *mode, bool files, bool buffers, char *memory)
+{
+    UringEngine engine;
+    Endpoint ep = Endpoint::loopback(1230);
+    Socket listener;
+    listener.listen(ep);
+    std::vector<Socket> sockets;
+    sockets.reserve(2 * PAIRS);
+    for (int i = 0; i < PAIRS; ++i) {
+        Socket &client = sockets.emplace_back();
+        client.connect(ep);
+        sockets.push_back(listener.accept());
+    }
+
+    // socket i uses slot i of the memory, registered as buffer i
+    std::vector<struct iovec> iov(2 * PAIRS);
+    std::vector<UringEngine::Hot> hot(2 * PAIRS);
+    if ((files && !engine.registerFiles(2 * PAIRS))
+        || (buffers && (iov.assign(1, { memory, 2 * PAIRS * SLOT }), !engine.registerBuffers(iov.data(), 1)))) {
+        std::cerr << mode << ": register: " << std::strerror(engine.errcode()) << std::endl;
+        return (0);
+    }
+    for (int i = 0; i < 2 * PAIRS; ++i) {
+        int one = 1;
+        setsockopt(sockets[i].fd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        hot[i] = files ? engine.hot(sockets[i].fd()) : UringEngine::Hot{ sockets[i].fd(), -1 };
+    }
+    int buffer = buffers ? 0 : -1;
+
+    bool ok = true;
+    double cpu = cpuSeconds();
+    for (int r = 0; r < ROUNDS && ok; ++r)
+        for (int from = 0; from < 2 && ok; ++from) {
+            for (int p = 0; p < PAIRS; ++p) {
+                int src = 2 * p + from;
+                int dst = 2 * p + 1 - from;
+                engine.write(hot[src], memory + src * SLOT, MESSAGE, src, buffer);
+                engine.read(hot[dst], memory + dst * SLOT, MESSAGE, dst, buffer);
+            }
+            ok = collect(engine, 2 * PAIRS);
+        }
+    cpu = cpuSeconds() - cpu;
+    for (UringEngine::Hot &h : hot)
+        engine.cool(h);
+    if (!ok) {
+        std::cerr << mode << ": ping-pong failed" << std::endl;
+        return (0);
+    }
+    return (cpu / (ROUNDS * 4.0 * PAIRS));
+}
+
+int main(void)
+{
+    char *memory = static_cast<char *>(std::aligned_alloc(SLOT, 2 * PAIRS * SLOT));
+
+    const char *modes[] = { "plain", "registered descriptors", "registered descriptors and buffers" };
+    double best[3] = { 1, 1, 1 };
+    for (int pass = 0; pass < PASSES; ++pass)
+        for (int m = 0; m < 3; ++m) {
+            double cpu = run(modes[m], m >= 1, m == 2, memory);
+            if (cpu == 0)
+                return 1;
+            best[m] = std::min(best[m], cpu);
+        }
+    for (int m = 0; m < 3; ++m)
+        std::cout << modes[m] << ": " << best[m] * 1e9 << " ns CPU per operation ("
+                  << (best[m] / best[0] - 1) * 100 << "% against plain)" << std::endl;
+    std::free(memory);
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "../Http.hpp"
+
+static const std::string REQUEST =
+    "GET /status HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "User-Agent: libsocket-bench\r\n"
+    "Accept: */*\r\n"
+    "\r\n";
+static const std::string RESPONSE =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Length: 5\r\n"
+    "\r\n"
+    "hello";
+
+static const int REQUESTS = 200000;
+static const int DEPTH = 32;
+
+/**
+ * @brief Previous approach: one getline and a few allocations per header
+ */
+static void getlineServer(Socket &server)
+{
+    Socket client = server.accept();
+    std::string line;
+
+    client.setNoDelay(true);
+    while (client.getline(line)) {
+        std::unordered_map<std::string, std::string> headers;
+        while (client.getline(line) && line != "\r") {
+            std::size_t colon = line.find(':');
+            if (colon != std::string::npos)
+                headers[line.substr(0, colon)] = line.substr(colon + 2);
+        }
+        client.write(RESPONSE.data(), RESPONSE.size());
+    }
+}
+
+static double runClient(uint16_t port)
+{
+    Socket client;
+    std::string batch;
+    std::string buffer(65536, '\0');
+
+    for (int i = 0; i < DEPTH; ++i)
+        batch += REQUEST;
+    client.connect(Endpoint::loopback(port));
+    auto start = std::chrono::steady_clock::now();
+    for (int sent = 0; sent < REQUESTS; sent += DEPTH) {
+        std::size_t expected = DEPTH * RESPONSE.size();
+        client.write(batch.data(), batch.size());
+        while (expected > 0 && client.read(&buffer[0], std::min(expected, buffer.size())))
+            expected -= client.gcount();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (REQUESTS / elapsed.count());
+}
+
+int main(void)
+{
+    Socket legacy;
+    legacy.listen(Endpoint::any(1213));
+    std::thread legacyThread(getlineServer, std::ref(legacy));
+    std::cout << "getline server: " << runClient(1213) << " req/s" << std::endl;
+    legacyThread.join();
+
+    EventLoop loop;
+    HttpServer server(loop, [](const HttpRequest &, HttpResponse &res) { res.body("hello"); });
+    server.listen(Endpoint::any(1214));
+    std::thread loopThread([&loop]() { loop.run(); });
+    std::cout << "HttpServer:     " << runClient(1214) << " req/s" << std::endl;
+    loop.stop();
+    loopThread.join();
+    return 0;
+}
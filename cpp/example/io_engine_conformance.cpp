@@ -0,0 +1,174 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../IoEngine.hpp"
+#include "../Socket.hpp"
+
+// Runs the same checks over loopback against each backend.
+
+static int failures = 0;
+
+static void check(const char *engine, const char *what, bool ok)
+{
+    std::cout << engine << ": " << what << ": " << (ok ? "ok" : "FAILED") << std::endl;
+    failures += !ok;
+}
+
+/**
+ * @brief Wait until completions for 'count' operations arrived, indexed by user value
+ */
+template <typename Engine>
+static bool collect(Engine &engine, std::vector<IoCompletion> &done, int count)
+{
+    IoCompletion batch[16];
+
+    done.assign(16, IoCompletion{ 0, -1, 0 });
+    while (count > 0) {
+        int n = engine.wait(batch, 16, 2000);
+        if (n <= 0)
+            return (false);
+        for (int i = 0; i < n; ++i)
+            done[batch[i].user] = batch[i];
+        count -= n;
+    }
+    return (true);
+}
+
+template <typename Engine>
+static void conformance(uint16_t port)
+{
+    Engine engine;
+    const char *name = Engine::name();
+    std::vector<IoCompletion> done;
+    Endpoint ep = Endpoint::loopback(port);
+
+    check(name, "setup", engine.good());
+    Socket listener;
+    listener.listen(ep);
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+
+    // accept and connect complete together
+    engine.accept(listener.fd(), 1);
+    engine.connect(client, ep, 2);
+    bool ok = collect(engine, done, 2);
+    check(name, "accept and connect", ok && done[1].result >= 0 && done[2].result == 0);
+    int server = done[1].result;
+
+    // data round trip
+    char buf[64] = {};
+    engine.read(server, buf, sizeof(buf), 3);
+    engine.write(client, "ping", 4, 4);
+    ok = collect(engine, done, 2);
+    check(name, "write then read", ok && done[4].result == 4 && done[3].result == 4 && std::string(buf, 4) == "ping");
+
+    // several reads pending on one descriptor all complete, not necessarily in order
+    char a[2] = {}, b[2] = {};
+    engine.read(server, a, 2, 5);
+    engine.read(server, b, 2, 6);
+    engine.write(client, "abcd", 4, 7);
+    ok = collect(engine, done, 3);
+    std::string joined = std::string(a, 2) + std::string(b, 2);
+    check(name, "queued reads", ok && done[5].result == 2 && done[6].result == 2
+          && (joined == "abcd" || joined == "cdab"));
+
+    // hot descriptors behave like plain ones
+    typename Engine::Hot hot = engine.registerFiles(4) ? engine.hot(server) : typename Engine::Hot{ server, -1 };
+    engine.read(hot, buf, sizeof(buf), 5);
+    engine.write(client, "pong", 4, 6);
+    ok = collect(engine, done, 2);
+    engine.cool(hot);
+    check(name, "hot descriptor", ok && done[5].result == 4 && std::string(buf, 4) == "pong");
+
+    // a request linked to the read of its response, with a timeout
+    char response[64] = {};
+    engine.write(client, "req", 3, 5);
+    engine.link();
+    engine.read(client, response, sizeof(response), 6);
+    engine.linkTimeout(2000);
+    engine.read(server, buf, sizeof(buf), 7);
+    ok = collect(engine, done, 2);
+    ok = ok && done[5].result == 3 && done[7].result == 3;
+    engine.write(server, "resp", 4, 8);
+    ok = collect(engine, done, 2) && ok;
+    check(name, "linked write and read", ok && done[6].result == 4 && std::string(response, 4) == "resp");
+
+    // a linked operation waits for its predecessor, whatever the direction
+    IoCompletion early[4];
+    engine.read(server, buf, sizeof(buf), 5);
+    engine.link();
+    engine.write(server, "late", 4, 6);
+    bool held = engine.wait(early, 4, 50) == 0;
+    engine.write(client, "go", 2, 7);
+    ok = collect(engine, done, 3);
+    ok = ok && done[5].result == 2 && done[6].result == 4;
+    engine.read(client, response, sizeof(response), 8);
+    ok = collect(engine, done, 1) && ok;
+    check(name, "linked operation held", held && ok && done[8].result == 4 && std::string(response, 4) == "late");
+
+    // a failed predecessor cancels the rest of the chain
+    engine.read(-1, buf, sizeof(buf), 5);
+    engine.link();
+    engine.write(server, "no", 2, 6);
+    engine.link();
+    engine.write(server, "no", 2, 7);
+    ok = collect(engine, done, 3);
+    check(name, "failed link cancels chain", ok && done[5].result == -EBADF && done[6].result == -ECANCELED
+          && done[7].result == -ECANCELED);
+
+    engine.read(client, response, sizeof(response), 5);
+    engine.linkTimeout(50);
+    ok = collect(engine, done, 1);
+    check(name, "link timeout", ok && done[5].result == -ECANCELED);
+
+    // large transfer, possibly split into partial writes
+    std::string big(4 << 20, 'x');
+    std::string received;
+    std::vector<char> chunk(65536);
+    std::size_t sent = 0;
+    engine.write(client, big.data(), big.size(), 8);
+    engine.read(server, chunk.data(), chunk.size(), 9);
+    IoCompletion batch[16];
+    int n = 0;
+    ok = true;
+    while (ok && received.size() < big.size() && (n = engine.wait(batch, 16, 2000)) > 0)
+        for (int i = 0; i < n; ++i) {
+            if (batch[i].user == 8 && batch[i].result > 0) {
+                sent += batch[i].result;
+                if (sent < big.size())
+                    engine.write(client, big.data() + sent, big.size() - sent, 8);
+            } else if (batch[i].user == 9 && batch[i].result > 0) {
+                received.append(chunk.data(), batch[i].result);
+                engine.read(server, chunk.data(), chunk.size(), 9);
+            } else {
+                ok = false;
+            }
+        }
+    check(name, "4 MB transfer", ok && received == big);
+    // drain the read left pending by the loop above with the end of stream
+    engine.close(client, 10);
+    ok = collect(engine, done, 2);
+    check(name, "close, then end of stream", ok && done[10].result == 0 && done[9].result == 0);
+
+    // errors are reported as -errno
+    engine.read(-1, buf, sizeof(buf), 11);
+    ok = collect(engine, done, 1);
+    check(name, "invalid descriptor", ok && done[11].result == -EBADF);
+    int refused = socket(AF_INET, SOCK_STREAM, 0);
+    engine.connect(refused, Endpoint::loopback(port + 100), 12);
+    ok = collect(engine, done, 1);
+    check(name, "connection refused", ok && done[12].result == -ECONNREFUSED);
+
+    engine.close(server, 13);
+    engine.close(refused, 14);
+    ok = collect(engine, done, 2);
+    check(name, "close", ok && done[13].result == 0 && done[14].result == 0);
+}
+
+int main(void)
+{
+    conformance<EpollEngine>(1228);
+    conformance<UringEngine>(1229);
+    std::cout << (failures == 0 ? "all checks passed" : "some checks FAILED") << std::endl;
+    return (failures != 0);
+}
@@ -0,0 +1,86 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <netinet/tcp.h>
+
+#include "../IoEngine.hpp"
+#include "../Socket.hpp"
+
+// Request/response round trips against an echo thread: the client either
+// submits the write and the read separately, or as a linked chain in one
+// submission, optionally ended by a link timeout.
+
+static const int ROUNDS = 50000;
+static const std::size_t MESSAGE = 64;
+
+static bool collect(UringEngine &engine, int count)
+{
+    IoCompletion batch[4];
+
+    while (count > 0) {
+        int n = engine.wait(batch, 4, 2000);
+        if (n <= 0)
+            return (false);
+        for (int i = 0; i < n; ++i)
+            if (batch[i].result != static_cast<int>(MESSAGE))
+                return (false);
+        count -= n;
+    }
+    return (true);
+}
+
+static void run(const char *mode, bool linked, bool timeout, uint16_t port)
+{
+    Endpoint ep = Endpoint::loopback(port);
+    Socket listener;
+    listener.listen(ep);
+    std::thread echo([&listener]() {
+        Socket peer = listener.accept();
+        int one = 1;
+        setsockopt(peer.fd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        char buf[MESSAGE];
+        while (peer.read(buf, MESSAGE) && peer.gcount() == MESSAGE)
+            peer.write(buf, MESSAGE);
+    });
+    Socket client;
+    client.connect(ep);
+    int one = 1;
+    setsockopt(client.fd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    UringEngine engine;
+    char request[MESSAGE] = {}, response[MESSAGE] = {};
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS && ok; ++i) {
+        if (linked) {
+            engine.write(client.fd(), request, MESSAGE, 1);
+            engine.link();
+            engine.read(client.fd(), response, MESSAGE, 2);
+            if (timeout)
+                engine.linkTimeout(1000);
+            ok = collect(engine, 2);
+        } else {
+            engine.write(client.fd(), request, MESSAGE, 1);
+            ok = collect(engine, 1);
+            engine.read(client.fd(), response, MESSAGE, 2);
+            ok = ok && collect(engine, 1);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    client.close();
+    echo.join();
+    if (!ok) {
+        std::cout << mode << ": round trip failed" << std::endl;
+        return;
+    }
+    std::cout << mode << ": " << ROUNDS / elapsed.count() / 1e3 << " k round trips/s, "
+              << engine.stats().enters / double(ROUNDS) << " system calls per round trip" << std::endl;
+}
+
+int main(void)
+{
+    run("separate write and read", false, false, 1234);
+    run("linked write and read", true, false, 1235);
+    run("linked write, read and timeout", true, true, 1236);
+    return 0;
+}
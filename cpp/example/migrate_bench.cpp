@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Http.hpp"
+
+// Two reactor threads, each running an HttpServer on its own EventLoop. All
+// clients connect to the first one; halfway through, a rebalancer task on
+// the first loop moves its busiest connections to the second one while the
+// clients keep sending pipelined requests over the same connections.
+
+static const std::string REQUEST = "GET /status HTTP/1.1\r\nHost: localhost\r\n\r\n";
+static const std::string RESPONSE = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+static const int CLIENTS = 8;
+static const int DEPTH = 8;
+
+int main(void)
+{
+    EventLoop loopA, loopB;
+    std::atomic<long> servedA{ 0 }, servedB{ 0 };
+    HttpServer serverA(loopA, [&servedA](const HttpRequest &, HttpResponse &res) { ++servedA; res.body("hello"); });
+    HttpServer serverB(loopB, [&servedB](const HttpRequest &, HttpResponse &res) { ++servedB; res.body("hello"); });
+    Endpoint ep = Endpoint::loopback(1237);
+    if (!serverA.listen(ep)) {
+        std::cerr << "listen: " << serverA.socket().strerror() << std::endl;
+        return 1;
+    }
+    std::thread threadA([&loopA]() { loopA.run(-1); });
+    std::thread threadB([&loopB]() { loopB.run(-1); });
+
+    std::atomic<bool> stop{ false };
+    std::atomic<int> errors{ 0 };
+    std::vector<std::thread> clients;
+    for (int c = 0; c < CLIENTS; ++c)
+        clients.emplace_back([&, c]() {
+            Socket client;
+            std::string batch;
+            std::string buffer(4096, '\0');
+            // uneven load, so that the rebalancer has busier connections to pick
+            int depth = 1 + c % DEPTH;
+            for (int i = 0; i < depth; ++i)
+                batch += REQUEST;
+            client.connect(ep);
+            while (!stop && client) {
+                std::size_t expected = depth * RESPONSE.size();
+                client.write(batch.data(), batch.size());
+                while (expected > 0 && client.read(&buffer[0], std::min(expected, buffer.size())))
+                    expected -= client.gcount();
+                if (expected > 0)
+                    ++errors;
+            }
+        });
+
+    auto report = [&](const char *phase) {
+        long a = servedA.exchange(0), b = servedB.exchange(0);
+        std::cout << phase << ": first loop " << a << " requests, second loop " << b << " requests" << std::endl;
+    };
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    report("before");
+
+    std::atomic<int> moved{ -1 };
+    loopA.post([&]() {
+        std::vector<int> fds = serverA.connections();
+        std::sort(fds.begin(), fds.end(), [&](int x, int y) { return (serverA.requests(x) > serverA.requests(y)); });
+        int count = 0;
+        for (std::size_t i = 0; i < fds.size() / 2; ++i)
+            count += serverA.migrate(fds[i], serverB);
+        moved = count;
+    });
+    while (moved < 0)
+        std::this_thread::yield();
+    servedA = 0;
+    servedB = 0;
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    report("after moving the busiest half");
+
+    stop = true;
+    for (std::thread &t : clients)
+        t.join();
+    std::cout << moved << " connections moved, " << errors << " client errors" << std::endl;
+    loopA.stop();
+    loopB.stop();
+    threadA.join();
+    threadB.join();
+    return (errors != 0);
+}
@@ -0,0 +1,74 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../Numa.hpp"
+
+// For every pair of nodes, a thread pinned to the first node streams through
+// I/O buffers pooled on the second one, copying a message in and summing it
+// as a protocol parser would. Local pairs are the diagonal. On a single-node
+// box, run with --simulate N to exercise the same paths over N pretend nodes;
+// memory placement is then skipped and all pairs should match.
+// Usage: numa_bench [--simulate nodes]
+
+static const std::size_t BUFFER = 16 << 10;
+static const std::size_t BUFFERS = 4096;
+static const int PASSES = 8;
+
+int main(int argc, char **argv)
+{
+    bool simulate = argc > 2 && std::strcmp(argv[1], "--simulate") == 0;
+    NumaTopology topo = simulate ? NumaTopology::simulate(std::atoi(argv[2])) : NumaTopology::discover();
+
+    std::cout << topo.nodes() << (topo.simulated() ? " simulated" : "") << " node(s):";
+    for (unsigned n = 0; n < topo.nodes(); ++n) {
+        std::cout << " node " << topo.id(n) << " cpus";
+        for (int cpu : topo.cpus(n))
+            std::cout << ' ' << cpu;
+        std::cout << ';';
+    }
+    std::cout << std::endl;
+    if (topo.nodes() == 1)
+        std::cout << "single node, nothing to compare: try --simulate 2" << std::endl;
+
+    std::vector<char> message(BUFFER, 'x');
+    for (unsigned bufferNode = 0; bufferNode < topo.nodes(); ++bufferNode) {
+        // the pool is filled by a thread of its node, as its event loop would
+        std::vector<char *> buffers;
+        BufferPool *pool = nullptr;
+        std::thread owner([&]() {
+            topo.pin(bufferNode);
+            pool = new BufferPool(topo, bufferNode, BUFFER);
+            for (std::size_t i = 0; i < BUFFERS; ++i)
+                buffers.push_back(pool->acquire());
+        });
+        owner.join();
+        int placed = NumaTopology::nodeOfPage(buffers[0]);
+
+        for (unsigned loopNode = 0; loopNode < topo.nodes(); ++loopNode) {
+            double seconds = 0;
+            uint64_t sum = 0;
+            std::thread worker([&]() {
+                topo.pin(loopNode);
+                auto start = std::chrono::steady_clock::now();
+                for (int pass = 0; pass < PASSES; ++pass)
+                    for (char *buf : buffers) {
+                        std::memcpy(buf, message.data(), BUFFER);
+                        for (std::size_t i = 0; i < BUFFER; i += 64)
+                            sum += static_cast<unsigned char>(buf[i]);
+                    }
+                seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            });
+            worker.join();
+            double bytes = double(BUFFER) * BUFFERS * PASSES;
+            std::cout << "loop on node " << loopNode << ", buffers on node " << bufferNode
+                      << (loopNode == bufferNode ? " (local): " : " (remote): ") << bytes / seconds / 1e9
+                      << " GB/s (pages on kernel node " << placed << ", " << sum % 2 << ")" << std::endl;
+        }
+        delete pool;
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../EventLoop.hpp"
+
+// Threads post tasks into a running EventLoop. Under load most posts find the
+// loop awake and cost no eventfd write; spaced out posts each wake it.
+
+static const int PRODUCERS = 4;
+static const long TASKS = 250000;
+
+int main(void)
+{
+    EventLoop loop;
+    long executed = 0;
+    std::thread loopThread([&loop]() { loop.run(-1); });
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p)
+        producers.emplace_back([&]() {
+            for (long i = 0; i < TASKS; ++i)
+                loop.post([&executed]() { ++executed; });
+        });
+    for (std::thread &t : producers)
+        t.join();
+    std::atomic<bool> drained{ false };
+    loop.post([&drained]() { drained = true; });
+    while (!drained)
+        std::this_thread::yield();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t writes = loop.notifier().writes();
+    std::cout << "burst: " << executed << " tasks from " << PRODUCERS << " threads, "
+              << executed / elapsed.count() / 1e6 << " M tasks/s, " << writes << " eventfd writes ("
+              << double(writes) / executed << " per task)" << std::endl;
+
+    executed = 0;
+    drained = false;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        loop.post([&executed]() { ++executed; });
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    loop.post([&drained]() { drained = true; });
+    while (!drained)
+        std::this_thread::yield();
+    writes = loop.notifier().writes() - writes;
+    std::cout << "spaced: " << executed << " tasks, " << writes << " eventfd writes" << std::endl;
+
+    loop.stop();
+    loopThread.join();
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../Socket.hpp"
+
+// One connection first carries a bulk transfer, then turns into a chatty
+// request stream of small messages. The bulk phase is received once with a
+// plain 4 KB read loop, as a fixed receive buffer would, then with
+// Socket::fill(), whose buffer grows; the chatty phase shows it shrinking
+// back so an idle connection does not keep the memory.
+
+static const std::size_t BULK = 256 << 20;
+static const std::size_t CHUNK = 64 << 10;
+static const int MESSAGES = 128;
+
+static void sendBulk(int fd)
+{
+    std::vector<char> chunk(CHUNK, 'b');
+    for (std::size_t sent = 0; sent < BULK;) {
+        ssize_t n = ::write(fd, chunk.data(), std::min(CHUNK, BULK - sent));
+        if (n <= 0)
+            break;
+        sent += n;
+    }
+}
+
+int main(void)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+        std::cerr << "socketpair failed" << std::endl;
+        return 1;
+    }
+
+    std::thread writer(sendBulk, fds[1]);
+    std::vector<char> fixed(Socket::RBUF_SIZE);
+    std::size_t received = 0, reads = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (received < BULK) {
+        ssize_t n = ::read(fds[0], fixed.data(), fixed.size());
+        if (n <= 0)
+            break;
+        received += n;
+        ++reads;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    writer.join();
+    std::cout << "fixed 4 KB buffer: " << reads << " reads, " << received / elapsed.count() / 1e9 << " GB/s" << std::endl;
+
+    Socket sock(fds[0]);
+    writer = std::thread(sendBulk, fds[1]);
+    received = 0;
+    reads = 0;
+    start = std::chrono::steady_clock::now();
+    while (received < BULK && sock.fill() > 0) {
+        received += sock.bufferedSize();
+        sock.consume(sock.bufferedSize());
+        ++reads;
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    writer.join();
+    std::cout << "adaptive buffer:   " << reads << " reads, " << received / elapsed.count() / 1e9
+              << " GB/s, buffer now " << sock.receiveBufferSize() / 1024 << " KB" << std::endl;
+
+    std::string message(100, 'm');
+    for (int i = 1; i <= MESSAGES; ++i) {
+        if (::write(fds[1], message.data(), message.size()) != static_cast<ssize_t>(message.size()) || sock.fill() <= 0)
+            break;
+        sock.consume(sock.bufferedSize());
+        if (i % 32 == 0)
+            std::cout << "after " << i << " small messages: buffer " << sock.receiveBufferSize() / 1024 << " KB" << std::endl;
+    }
+    ::close(fds[1]);
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../Socket.hpp"
+
+// A binary protocol of fixed headers followed by 16 KB payloads, received
+// over a socketpair either through the receive buffer, copying the header
+// and payload out of it, or with readv() straight into place. Then checks
+// that a message interrupted on a non-blocking socket is resumed intact,
+// through the header overload and through a plain iovec array.
+
+struct Header
+{
+    uint32_t type;
+    uint32_t sequence;
+    uint64_t checksum;
+};
+
+static const std::size_t PAYLOAD = 16 << 10;
+static const uint32_t MESSAGES = 16384;
+
+static void sendMessages(int fd)
+{
+    std::vector<char> message(sizeof(Header) + PAYLOAD, 'p');
+    for (uint32_t i = 0; i < MESSAGES; ++i) {
+        Header header = { 1, i, 0 };
+        std::memcpy(message.data(), &header, sizeof(header));
+        for (std::size_t sent = 0; sent < message.size();) {
+            ssize_t n = ::write(fd, message.data() + sent, message.size() - sent);
+            if (n <= 0)
+                return;
+            sent += n;
+        }
+    }
+}
+
+template <typename Receive>
+static void run(const char *mode, Receive receive)
+{
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    Socket sock(fds[0]);
+    std::vector<char> payload(PAYLOAD);
+    Header header = {};
+    uint32_t ok = 0;
+
+    std::thread writer(sendMessages, fds[1]);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < MESSAGES && receive(sock, header, payload.data()); ++i)
+        ok += header.sequence == i && payload[PAYLOAD - 1] == 'p';
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    writer.join();
+    ::close(fds[1]);
+    std::cout << mode << ": " << MESSAGES / elapsed.count() << " messages/s, " << ok << "/" << MESSAGES << " intact" << std::endl;
+}
+
+int main(void)
+{
+    run("copy from receive buffer", [](Socket &sock, Header &header, char *payload) {
+        while (sock.bufferedSize() < sizeof(Header) + PAYLOAD)
+            if (sock.fill() <= 0)
+                return (false);
+        std::memcpy(&header, sock.bufferedData(), sizeof(Header));
+        std::memcpy(payload, sock.bufferedData() + sizeof(Header), PAYLOAD);
+        sock.consume(sizeof(Header) + PAYLOAD);
+        return (true);
+    });
+    run("readv into place        ", [](Socket &sock, Header &header, char *payload) {
+        return (sock.readv(header, payload, PAYLOAD).gcount() > 0);
+    });
+
+    // header and half of the payload, then the rest once the read would block
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    Socket sock(fds[0]);
+    std::vector<char> message(sizeof(Header) + PAYLOAD, 'r');
+    Header sent = { 2, 42, 7 }, header = {};
+    std::vector<char> payload(PAYLOAD);
+    std::memcpy(message.data(), &sent, sizeof(sent));
+    bool resumed = ::write(fds[1], message.data(), message.size() / 2) > 0
+                   && sock.readv(header, payload.data(), PAYLOAD).gcount() == 0 && sock.bufferedSize() == message.size() / 2;
+    resumed = resumed && ::write(fds[1], message.data() + message.size() / 2, message.size() - message.size() / 2) > 0
+              && sock.readv(header, payload.data(), PAYLOAD).gcount() > 0 && sock.good() && header.sequence == 42 && header.checksum == 7
+              && payload[0] == 'r' && payload[PAYLOAD - 1] == 'r' && sock.bufferedSize() == 0;
+    std::cout << "interrupted message " << (resumed ? "resumed intact" : "CORRUPTED") << std::endl;
+
+    // the header and part of the payload, then the rest, into the same iovec array
+    char head[4] = {}, body[8] = {};
+    struct iovec iov[2] = { { head, sizeof(head) }, { body, sizeof(body) } };
+    bool split = ::write(fds[1], "HHHHpp", 6) == 6 && sock.readv(iov, 2).gcount() == 6
+                 && ::write(fds[1], "pppppp", 6) == 6 && sock.readv(iov, 2).gcount() == 6 && sock.good()
+                 && std::string(head, sizeof(head)) == "HHHH" && std::string(body, sizeof(body)) == "pppppppp"
+                 && iov[0].iov_len == 0 && iov[1].iov_len == 0;
+    std::cout << "split delivery into an iovec array " << (split ? "resumed intact" : "CORRUPTED") << std::endl;
+    ::close(fds[1]);
+    return (!resumed || !split);
+}
@@ -0,0 +1,51 @@
+#include <chrono>
+#include <iostream>
+
+#include "../Resolver.hpp"
+
+static const int LOOKUPS = 100000;
+
+int main(int argc, char **argv)
+{
+    const char *host = argc > 1 ? argv[1] : "localhost";
+    EventLoop loop;
+    Resolver resolver(loop);
+
+    // concurrent lookups of one name share a single query
+    int completed = 0;
+    in_addr_t addr = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i)
+        resolver.resolve(host, [&](int error, const Resolver::Addresses &addrs) {
+            if (error != 0 && completed == 0)
+                std::cerr << host << ": " << gai_strerror(error) << std::endl;
+            else if (completed == 0 && Resolver::ipv4(addrs, addr))
+                std::cout << host << " -> " << inet_ntoa(in_addr{ addr }) << " (" << addrs.size() << " addresses)" << std::endl;
+            if (++completed == 1000)
+                loop.stop();
+        });
+    loop.run(10);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "1000 concurrent lookups: " << resolver.queries() << " query, "
+              << elapsed.count() * 1e3 << " ms" << std::endl;
+
+    // later lookups are served from the cache, inline
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LOOKUPS; ++i)
+        resolver.resolve(host, [&](int, const Resolver::Addresses &) { ++completed; });
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "cached: " << LOOKUPS / elapsed.count() << " lookups/s, "
+              << resolver.queries() << " query in total" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        struct addrinfo hints = {};
+        struct addrinfo *res = nullptr;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, nullptr, &hints, &res) == 0)
+            freeaddrinfo(res);
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "blocking getaddrinfo: " << 1000 / elapsed.count() << " lookups/s" << std::endl;
+    return 0;
+}
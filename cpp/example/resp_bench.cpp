@@ -0,0 +1,54 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "../Resp.hpp"
+
+static const int COMMANDS = 2000000;
+static const int BATCH = 1000;
+
+int main(void)
+{
+    EventLoop loop;
+    std::unordered_map<std::string, std::string> store;
+    RespServer server(loop, [&store](const std::vector<RespValue> &cmd, RespWriter &out) {
+        std::string_view name = cmd[1].str;
+        if (name == "SET" && cmd[0].count == 3) {
+            store[std::string(cmd[2].str)] = std::string(cmd[3].str);
+            out.simple("OK");
+        } else if (name == "GET" && cmd[0].count == 2) {
+            auto it = store.find(std::string(cmd[2].str));
+            if (it == store.end())
+                out.null();
+            else
+                out.bulk(it->second);
+        } else if (name == "PING") {
+            out.simple("PONG");
+        } else {
+            out.error("ERR unknown command");
+        }
+    });
+    server.listen(Endpoint::any(1215));
+    std::thread loopThread([&loop]() { loop.run(); });
+
+    Socket sock;
+    sock.connect(Endpoint::loopback(1215));
+    RespClient client(sock);
+    std::vector<RespValue> reply;
+    auto start = std::chrono::steady_clock::now();
+    for (int sent = 0; sent < COMMANDS; sent += BATCH) {
+        for (int i = 0; i < BATCH; ++i)
+            client.send({ "SET", "key", "value" });
+        client.flush();
+        while (client.pending() > 0 && client.receive(reply))
+            ;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "pipelined SET: " << COMMANDS / elapsed.count() << " ops/s" << std::endl;
+
+    loop.stop();
+    loopThread.join();
+    return 0;
+}
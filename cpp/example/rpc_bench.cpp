@@ -0,0 +1,53 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../Rpc.hpp"
+
+static const int CONNECTIONS = 4;
+static const int WINDOW = 512;
+static const long REQUESTS = 2000000;
+
+int main(void)
+{
+    EventLoop serverLoop;
+    RpcServer server(serverLoop, [](std::string_view request, std::string &response) { response.append(request); });
+    server.listen(Endpoint::any(1217));
+    std::thread serverThread([&serverLoop]() { serverLoop.run(); });
+
+    EventLoop loop;
+    std::vector<std::unique_ptr<RpcClient>> clients;
+    for (int i = 0; i < CONNECTIONS; ++i) {
+        Socket sock;
+        sock.connect(Endpoint::loopback(1217));
+        clients.push_back(std::make_unique<RpcClient>(loop, std::move(sock)));
+    }
+
+    long issued = 0;
+    long completed = 0;
+    std::function<void(RpcClient &)> issue = [&](RpcClient &client) {
+        if (issued >= REQUESTS)
+            return;
+        ++issued;
+        client.call("ping", [&](bool ok, std::string_view) {
+            if (ok && ++completed == REQUESTS)
+                loop.stop();
+            issue(client);
+        });
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (auto &client : clients)
+        for (int i = 0; i < WINDOW; ++i)
+            issue(*client);
+    loop.run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << CONNECTIONS << " connections, " << WINDOW << " in flight each: "
+              << completed / elapsed.count() << " req/s" << std::endl;
+
+    serverLoop.stop();
+    serverThread.join();
+    return 0;
+}
@@ -4,7 +4,7 @@ int main(void)
 {
     Socket server;
 
-    server.listen(htons(1212), INADDR_ANY, SOMAXCONN);
+    server.listen(Endpoint::any(1212));
     Socket client = server.accept();
     client.write("hello world!\n", 13);
     return 0;
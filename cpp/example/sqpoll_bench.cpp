@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <netinet/tcp.h>
+
+#include "../IoEngine.hpp"
+#include "../Socket.hpp"
+
+// 64-byte ping-pong round trip latency over loopback, with the default
+// io_uring setup and with a submission polling thread, blocking or spinning
+// on completions. Every BURST round trips the sender pauses for longer than
+// the poller idle timeout, so that the poller goes idle and must be woken.
+// Usage: sqpoll_bench [poller cpu]
+
+static const int ROUNDS = 20000;
+static const int BURST = 1000;
+static const unsigned IDLE_MS = 10;
+static const std::size_t MESSAGE = 64;
+
+static bool collect(UringEngine &engine, int count, bool spin)
+{
+    IoCompletion batch[4];
+
+    while (count > 0) {
+        int n = engine.wait(batch, 4, spin ? 0 : 2000);
+        if (n < 0 || (n == 0 && !spin))
+            return (false);
+        for (int i = 0; i < n; ++i)
+            if (batch[i].result != static_cast<int>(MESSAGE))
+                return (false);
+        count -= n;
+    }
+    return (true);
+}
+
+static void run(const char *mode, UringEngine &engine, bool spin, uint16_t port)
+{
+    if (!engine.good()) {
+        std::cout << mode << ": setup: " << std::strerror(engine.errcode()) << std::endl;
+        return;
+    }
+    Endpoint ep = Endpoint::loopback(port);
+    Socket listener;
+    listener.listen(ep);
+    Socket client;
+    client.connect(ep);
+    Socket server = listener.accept();
+    int one = 1;
+    setsockopt(client.fd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(server.fd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    char cbuf[MESSAGE] = {}, sbuf[MESSAGE] = {};
+    std::vector<double> rtt;
+    rtt.reserve(ROUNDS);
+    bool ok = true;
+    for (int i = 0; i < ROUNDS && ok; ++i) {
+        if (i % BURST == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(2 * IDLE_MS));
+        auto start = std::chrono::steady_clock::now();
+        engine.write(client.fd(), cbuf, MESSAGE, 1);
+        engine.read(server.fd(), sbuf, MESSAGE, 2);
+        ok = collect(engine, 2, spin);
+        engine.write(server.fd(), sbuf, MESSAGE, 3);
+        engine.read(client.fd(), cbuf, MESSAGE, 4);
+        ok = ok && collect(engine, 2, spin);
+        rtt.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    if (!ok) {
+        std::cout << mode << ": ping-pong failed" << std::endl;
+        return;
+    }
+    std::sort(rtt.begin(), rtt.end());
+    const UringEngine::Stats &stats = engine.stats();
+    std::cout << mode << ": round trip p50 " << rtt[rtt.size() / 2] << " us, p99 " << rtt[rtt.size() * 99 / 100]
+              << " us, p99.9 " << rtt[rtt.size() * 999 / 1000] << " us; " << stats.enters / double(ROUNDS)
+              << " system calls per round trip, poller woken " << stats.wakeups << " times in "
+              << stats.submits << " submissions" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    int cpu = argc > 1 ? std::atoi(argv[1]) : -1;
+    unsigned cpus = std::thread::hardware_concurrency();
+
+    if (cpus < 2)
+        std::cout << "only " << cpus << " CPU: the poller competes with this thread" << std::endl;
+    {
+        UringEngine engine;
+        run("default", engine, false, 1231);
+    }
+    {
+        UringEngine engine(256, UringEngine::SqPoll{ IDLE_MS, cpu });
+        run("sqpoll, blocking wait", engine, false, 1232);
+    }
+    // a spinning waiter would hold the only CPU for whole time slices
+    if (cpus < 2) {
+        std::cout << "sqpoll, spinning wait: skipped, the poller needs a CPU of its own" << std::endl;
+    } else {
+        UringEngine engine(256, UringEngine::SqPoll{ IDLE_MS, cpu });
+        run("sqpoll, spinning wait", engine, true, 1233);
+    }
+    return 0;
+}
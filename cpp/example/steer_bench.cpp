@@ -0,0 +1,64 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../Socket.hpp"
+
+// LISTENERS sockets share a port through SO_REUSEPORT, as one per worker
+// thread would (worker i pinned to CPU i). Connections are spread by the
+// kernel's hash, then by a classic BPF program keyed on the receiving CPU;
+// we count the accepted sockets whose SO_INCOMING_CPU is the CPU of the
+// worker owning their listener (modulo LISTENERS on bigger machines).
+
+static const unsigned LISTENERS = 4;
+static const int CONNECTIONS = 400;
+
+static void run(const char *mode, bool steer, uint16_t port)
+{
+    Endpoint ep = Endpoint::loopback(port);
+    std::vector<Socket> listeners;
+    listeners.reserve(LISTENERS);
+    for (unsigned i = 0; i < LISTENERS; ++i) {
+        Socket &listener = listeners.emplace_back();
+        listener.setReusePort(true);
+        listener.listen(ep);
+        listener.setBlocking(false);
+        if (!listener) {
+            std::cerr << mode << ": listen: " << listener.strerror() << std::endl;
+            return;
+        }
+    }
+    if (steer && !listeners[0].steerByCpu(LISTENERS)) {
+        std::cerr << mode << ": steerByCpu: " << listeners[0].strerror() << std::endl;
+        return;
+    }
+
+    std::vector<Socket> clients;
+    clients.reserve(CONNECTIONS);
+    for (int i = 0; i < CONNECTIONS; ++i)
+        clients.emplace_back().connect(ep);
+
+    int local = 0;
+    std::cout << mode << ":";
+    for (unsigned i = 0; i < LISTENERS; ++i) {
+        int accepted = 0;
+        while (true) {
+            Socket conn = listeners[i].accept();
+            if (!conn.isOpen())
+                break;
+            ++accepted;
+            int cpu = conn.incomingCpu();
+            local += cpu >= 0 && static_cast<unsigned>(cpu) % LISTENERS == i;
+        }
+        std::cout << " listener " << i << " accepted " << accepted << ";";
+    }
+    std::cout << " " << local * 100 / CONNECTIONS << "% handled on their receiving CPU" << std::endl;
+}
+
+int main(void)
+{
+    std::cout << std::thread::hardware_concurrency() << " CPUs" << std::endl;
+    run("hash", false, 1238);
+    run("steered by CPU", true, 1239);
+    return 0;
+}
@@ -0,0 +1,73 @@
+/*
+* Build: g++ -std=c++17 -O2 tls_bench.cpp -o tls_bench -pthread -lssl -lcrypto
+* Kernel TLS needs the "tls" module (modprobe tls).
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../Tls.hpp"
+
+static const std::size_t TOTAL = 1ul << 30;
+static const std::size_t CHUNK = 1 << 16;
+
+int main(void)
+{
+    char path[] = "/tmp/tls_bench_XXXXXX";
+    int file = mkstemp(path);
+    std::string chunk(CHUNK, 'x');
+    for (std::size_t written = 0; written < 64 * CHUNK; written += CHUNK)
+        if (::write(file, chunk.data(), CHUNK) != static_cast<ssize_t>(CHUNK))
+            return 1;
+    unlink(path);
+
+    Socket listener;
+    listener.listen(Endpoint::any(1223));
+    for (int mode = 0; mode < 3; ++mode) {
+        bool ktls = (mode > 0);
+        bool sendfile = (mode == 2);
+        TlsContext serverCtx(TlsContext::Server, ktls);
+        TlsContext clientCtx(TlsContext::Client, ktls);
+        serverCtx.useSelfSigned("localhost");
+        clientCtx.trust(serverCtx);
+
+        std::thread receiver([&listener, &serverCtx]() {
+            Socket client = listener.accept();
+            TlsSocket tls(client, serverCtx);
+            char buffer[CHUNK];
+            if (tls.accept())
+                while (tls.read(buffer, sizeof(buffer)))
+                    ;
+        });
+        Socket sock;
+        sock.connect(Endpoint::loopback(1223));
+        TlsSocket tls(sock, clientCtx);
+        if (!tls.connect("localhost")) {
+            std::cerr << "handshake failed: " << TlsContext::strerror() << std::endl;
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t sent = 0; sent < TOTAL; sent += 64 * CHUNK) {
+            if (sendfile) {
+                if (tls.sendfile(file, 0, 64 * CHUNK) != static_cast<ssize_t>(64 * CHUNK)) {
+                    std::cerr << "sendfile came up short" << std::endl;
+                    return 1;
+                }
+            } else
+                for (int i = 0; i < 64; ++i)
+                    tls.write(chunk.data(), CHUNK);
+        }
+        tls.shutdown();
+        sock.close();
+        receiver.join();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << tls.description() << (sendfile ? ", sendfile" : ", write")
+                  << ", kTLS " << (tls.ktlsSend() ? "on" : "off") << ": "
+                  << TOTAL / elapsed.count() / 1e6 << " MB/s" << std::endl;
+    }
+    ::close(file);
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../WebSocket.hpp"
+
+static const int MESSAGES = 20000;
+static const std::size_t MESSAGE_SIZE = 16384;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+int main(void)
+{
+    const unsigned char key[4] = { 0x12, 0x34, 0x56, 0x78 };
+    std::string data(MESSAGE_SIZE, 'x');
+    std::string out(MESSAGE_SIZE, '\0');
+
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < MESSAGES; ++n)
+        for (std::size_t i = 0; i < data.size(); ++i)
+            out[i] = data[i] ^ key[i & 3];
+    std::cout << "byte-wise masking:  " << MESSAGES * MESSAGE_SIZE / elapsed(start) / 1e9 << " GB/s" << std::endl;
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < MESSAGES; ++n)
+        WebSocket::mask(&out[0], data.data(), data.size(), key);
+    std::cout << "vectorized masking: " << MESSAGES * MESSAGE_SIZE / elapsed(start) / 1e9 << " GB/s" << std::endl;
+
+    Socket server;
+    server.listen(Endpoint::any(1216));
+    std::thread serverThread([&server]() {
+        Socket client = server.accept();
+        WebSocket ws(client, false);
+        std::string_view message;
+        WebSocket::Opcode op;
+        if (ws.accept())
+            while (ws.receive(message, op))
+                ;
+    });
+
+    Socket sock;
+    sock.connect(Endpoint::loopback(1216));
+    WebSocket ws(sock, true);
+    ws.handshake("localhost");
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < MESSAGES; ++n)
+        ws.send(data);
+    ws.close();
+    serverThread.join();
+    std::cout << "client to server:   " << MESSAGES * MESSAGE_SIZE / elapsed(start) / 1e9 << " GB/s" << std::endl;
+    return 0;
+}